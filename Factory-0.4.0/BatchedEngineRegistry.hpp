@@ -0,0 +1,181 @@
+#ifndef BATCHED_ENGINE_REGISTRY_HPP
+#define BATCHED_ENGINE_REGISTRY_HPP
+#include <memory>
+#include <vector>
+#include "PDOGS.cpp"
+#include "BatchedGameManager.hpp"
+#include "ReferenceGameManager.hpp"
+
+namespace Feis
+{
+    struct EngineShape
+    {
+        int width;
+        int height;
+        std::size_t bufferSize;
+    };
+
+    bool operator==(const EngineShape &lhs, const EngineShape &rhs)
+    {
+        return lhs.width == rhs.width && lhs.height == rhs.height && lhs.bufferSize == rhs.bufferSize;
+    }
+
+    // GameManagerConfig at another board and buffer size, with walls as dense as on the judged board.
+    template <int kWidth, int kHeight, std::size_t kBufferSize>
+    struct ShapedConfig : GameManagerConfig
+    {
+        static constexpr int kBoardWidth = kWidth;
+        static constexpr int kBoardHeight = kHeight;
+        static constexpr std::size_t kConveyorBufferSize = kBufferSize;
+        static constexpr int kNumberOfWalls =
+            GameManagerConfig::kNumberOfWalls * kWidth * kHeight / (GameManagerConfig::kBoardWidth * GameManagerConfig::kBoardHeight);
+    };
+
+    // A BatchedGameManager of any shape behind one interface; only the per-tick call is virtual.
+    class IBatchedEngine
+    {
+    public:
+        virtual EngineShape GetShape() const = 0;
+        virtual std::size_t GetLaneCount() const = 0;
+        virtual bool IsGameOver() const = 0;
+        virtual int GetElapsedTime() const = 0;
+        virtual int GetScores(std::size_t lane) const = 0;
+        virtual std::size_t GetStateHash(std::size_t lane) const = 0;
+        virtual void Update() = 0;
+        virtual ~IBatchedEngine() {}
+    };
+
+    template <std::size_t kLanes, typename TConfig>
+    class BatchedEngine : public IBatchedEngine
+    {
+    public:
+        BatchedEngine(std::array<BatchedLaneConfig, kLanes> lanes) : engine_(std::move(lanes)) {}
+
+        EngineShape GetShape() const override
+        {
+            return {TConfig::kBoardWidth, TConfig::kBoardHeight, TConfig::kConveyorBufferSize};
+        }
+
+        std::size_t GetLaneCount() const override { return kLanes; }
+
+        bool IsGameOver() const override { return engine_.IsGameOver(); }
+
+        int GetElapsedTime() const override { return engine_.GetElapsedTime(); }
+
+        int GetScores(std::size_t lane) const override { return engine_.GetScores(lane); }
+
+        std::size_t GetStateHash(std::size_t lane) const override { return engine_.GetStateHash(lane); }
+
+        void Update() override { engine_.Update(); }
+
+    private:
+        BatchedGameManager<kLanes, TConfig> engine_;
+    };
+
+    // A ReferenceGameManager of any shape behind one interface, to check a lane against and to lay
+    // out games on boards GameManager does not come in.
+    class IReferenceGame
+    {
+    public:
+        virtual bool IsGameOver() const = 0;
+        virtual int GetElapsedTime() const = 0;
+        virtual int GetScores() const = 0;
+        virtual std::size_t GetStateHash() const = 0;
+        virtual int GetNumber(CellPosition cellPosition) const = 0;
+        virtual bool CanBuild(CellPosition cellPosition) const = 0;
+        virtual void Update() = 0;
+        virtual ~IReferenceGame() {}
+    };
+
+    template <typename TConfig>
+    class ReferenceGame : public IReferenceGame
+    {
+    public:
+        ReferenceGame(const BatchedLaneConfig &lane) : game_(lane.commonDividor, lane.seed, lane.actions) {}
+
+        bool IsGameOver() const override { return game_.IsGameOver(); }
+
+        int GetElapsedTime() const override { return game_.GetElapsedTime(); }
+
+        int GetScores() const override { return game_.GetScores(); }
+
+        std::size_t GetStateHash() const override { return game_.GetStateHash(); }
+
+        int GetNumber(CellPosition cellPosition) const override { return game_.GetNumber(cellPosition); }
+
+        bool CanBuild(CellPosition cellPosition) const override { return game_.CanBuild(cellPosition); }
+
+        void Update() override { game_.Update(); }
+
+    private:
+        ReferenceGameManager<TConfig> game_;
+    };
+
+    // Maps a shape chosen at run time to the instantiation built for it. Add a shape by adding its
+    // config to the list in GetEntries.
+    class BatchedEngineRegistry
+    {
+    public:
+        static constexpr std::size_t kLanes = 8;
+
+        using Factory = std::unique_ptr<IBatchedEngine> (*)(std::vector<BatchedLaneConfig> &lanes);
+        using ReferenceFactory = std::unique_ptr<IReferenceGame> (*)(const BatchedLaneConfig &lane);
+
+        struct Entry
+        {
+            EngineShape shape;
+            Factory create;
+            ReferenceFactory createReference;
+        };
+
+        static const std::vector<Entry> &GetEntries()
+        {
+            static const std::vector<Entry> entries = {
+                MakeEntry<ShapedConfig<32, 18, 10>>(),
+                MakeEntry<GameManagerConfig>(),
+                MakeEntry<ShapedConfig<62, 36, 16>>(),
+                MakeEntry<ShapedConfig<124, 72, 10>>(),
+                MakeEntry<ShapedConfig<248, 144, 10>>(),
+            };
+            return entries;
+        }
+
+        // nullptr unless the shape was prebuilt.
+        static const Entry *Find(EngineShape shape)
+        {
+            for (const Entry &entry : GetEntries())
+            {
+                if (entry.shape == shape)
+                    return &entry;
+            }
+            return nullptr;
+        }
+
+        // nullptr unless the shape was prebuilt and exactly kLanes lanes are given.
+        static std::unique_ptr<IBatchedEngine> Create(EngineShape shape, std::vector<BatchedLaneConfig> lanes)
+        {
+            const Entry *entry = Find(shape);
+            if (entry == nullptr || lanes.size() != kLanes)
+                return nullptr;
+            return entry->create(lanes);
+        }
+
+    private:
+        template <typename TConfig>
+        static Entry MakeEntry()
+        {
+            Factory create = [](std::vector<BatchedLaneConfig> &lanes) -> std::unique_ptr<IBatchedEngine>
+            {
+                std::array<BatchedLaneConfig, kLanes> laneArray;
+                std::move(lanes.begin(), lanes.end(), laneArray.begin());
+                return std::make_unique<BatchedEngine<kLanes, TConfig>>(std::move(laneArray));
+            };
+            ReferenceFactory createReference = [](const BatchedLaneConfig &lane) -> std::unique_ptr<IReferenceGame>
+            {
+                return std::make_unique<ReferenceGame<TConfig>>(lane);
+            };
+            return {{TConfig::kBoardWidth, TConfig::kBoardHeight, TConfig::kConveyorBufferSize}, create, createReference};
+        }
+    };
+}
+#endif
@@ -0,0 +1,538 @@
+#ifndef BATCHED_GAME_MANAGER_HPP
+#define BATCHED_GAME_MANAGER_HPP
+#include <algorithm>
+#include <array>
+#include <cstdint>
+#include <queue>
+#include <typeinfo>
+#include <vector>
+#include "PDOGS.cpp"
+
+namespace Feis
+{
+    struct BatchedLaneConfig
+    {
+        int commonDividor;
+        unsigned int seed;
+        std::queue<PlayerAction> actions;
+    };
+
+    // Plays kLanes independent games in lockstep, e.g. one layout on many seeds. Every field of a
+    // cell is stored as kLanes consecutive values, one per game, and the update passes run over
+    // those lanes with selects instead of branches, so the compiler turns the conveyor shifts,
+    // capacity checks and mining timers into vector operations across games. Each lane follows
+    // exactly the rules of GameManager and ends with the same score as a GameManager given the
+    // same divisor, seed and actions. A cell is skipped only when no lane has a working entity on
+    // it, so lanes pay off when their layouts overlap. Players are scripted, since a player cannot
+    // look at a lane through IGameInfo.
+    //
+    // TConfig supplies the board size, buffer size, goal size, wall count and end time as
+    // constants, so every instantiation has its own constant loop bounds and neighbour offsets. Other
+    // configs lay their boards out the way GameManager would at that size; GameManager itself only
+    // exists at GameManagerConfig, so the other configs are compared with ReferenceGameManager.
+    template <std::size_t kLanes, typename TConfig = GameManagerConfig>
+    class BatchedGameManager
+    {
+    public:
+        using LaneConfig = BatchedLaneConfig;
+        using Config = TConfig;
+
+        BatchedGameManager(std::array<LaneConfig, kLanes> lanes)
+            : elapsedTime_{}, endTime_{TConfig::kEndTime}, cells_(kPaddedWidth * kPaddedHeight),
+              outputDirections_(kPaddedWidth * kPaddedHeight), hasConveyor_(kPaddedWidth * kPaddedHeight)
+        {
+            for (std::size_t lane = 0; lane < kLanes; ++lane)
+            {
+                commonDividors_[lane] = lanes[lane].commonDividor;
+                actions_[lane] = std::move(lanes[lane].actions);
+                scores_[lane] = 0;
+
+                // Backgrounds, the collection center and walls are laid out exactly as GameManager does.
+                BackgroundCellFactory backgroundCellFactory(lanes[lane].seed);
+                for (int row = 0; row < TConfig::kBoardHeight; ++row)
+                {
+                    for (int col = 0; col < TConfig::kBoardWidth; ++col)
+                    {
+                        auto numberCell = dynamic_cast<const NumberCell *>(backgroundCellFactory.Create().get());
+                        cells_[GetIndex({row, col})].number[lane] = numberCell ? numberCell->GetNumber() : 0;
+                    }
+                }
+
+                for (int i = 0; i < static_cast<int>(TConfig::kGoalSize); ++i)
+                {
+                    for (int j = 0; j < static_cast<int>(TConfig::kGoalSize); ++j)
+                    {
+                        cells_[GetIndex(kCollectionCenterTopLeft + CellPosition{i, j})].kind[lane] = kCollectionCenter;
+                    }
+                }
+
+                std::mt19937 gen(lanes[lane].seed);
+                for (int k = 1; k <= TConfig::kNumberOfWalls; ++k)
+                {
+                    CellPosition cellPosition;
+                    cellPosition.row = gen() % TConfig::kBoardHeight;
+                    cellPosition.col = gen() % TConfig::kBoardWidth;
+
+                    CellLanes &cell = cells_[GetIndex(cellPosition)];
+                    if (cell.kind[lane] == kEmpty)
+                    {
+                        cell.kind[lane] = kWall;
+                    }
+                }
+            }
+        }
+
+        static constexpr std::size_t GetLaneCount() { return kLanes; }
+
+        bool IsGameOver() const { return elapsedTime_ >= endTime_; }
+
+        int GetElapsedTime() const { return elapsedTime_; }
+
+        int GetScores(std::size_t lane) const { return scores_[lane]; }
+
+        // Equals ReferenceGameManager<TConfig>::GetStateHash, and so GameManager::GetStateHash at
+        // GameManagerConfig, of the game the lane plays.
+        std::size_t GetStateHash(std::size_t lane) const
+        {
+            std::size_t hash = 0;
+            for (int row = 0; row < TConfig::kBoardHeight; ++row)
+            {
+                for (int col = 0; col < TConfig::kBoardWidth; ++col)
+                {
+                    int index = GetIndex({row, col});
+                    const CellLanes &cell = cells_[index];
+                    std::array<int, kBufferSize> products{};
+                    Direction direction = static_cast<Direction>(cell.direction[lane]);
+
+                    switch (cell.kind[lane])
+                    {
+                    case kWall:
+                        HashForegroundCell(hash, typeid(WallCell).hash_code(), {row, col}, std::nullopt, products, 0);
+                        break;
+                    case kCollectionCenter:
+                        HashForegroundCell(hash, typeid(CollectionCenterCell).hash_code(),
+                                           kCollectionCenterTopLeft,
+                                           std::nullopt, products, 0);
+                        break;
+                    case kConveyor:
+                        for (int k = 0; k < kBufferSize; ++k)
+                        {
+                            products[k] = cell.products[k][lane];
+                        }
+                        HashForegroundCell(hash, typeid(ConveyorCell).hash_code(), {row, col}, direction, products, 0);
+                        break;
+                    case kCombiner:
+                    {
+                        bool isMainCell = cell.isMainCell[lane] != 0;
+                        int otherIndex = isMainCell ? index + kSecondCellOffsets[cell.direction[lane]]
+                                                    : index - kSecondCellOffsets[cell.direction[lane]];
+                        int topLeftIndex = std::min(index, otherIndex);
+                        products[0] = cells_[isMainCell ? index : otherIndex].products[0][lane];
+                        products[1] = cells_[isMainCell ? otherIndex : index].products[0][lane];
+                        HashForegroundCell(hash, typeid(CombinerCell).hash_code(),
+                                           {topLeftIndex / kPaddedWidth - 1, topLeftIndex % kPaddedWidth - 1},
+                                           isMainCell ? std::optional<Direction>(direction) : std::nullopt, products, 0);
+                        break;
+                    }
+                    case kMiningMachine:
+                        HashForegroundCell(hash, typeid(MiningMachineCell).hash_code(), {row, col}, direction, products,
+                                           cell.elapsedTime[lane]);
+                        break;
+                    default:
+                        HashCombine(hash, 0);
+                        break;
+                    }
+                }
+            }
+            HashCombine(hash, elapsedTime_);
+            HashCombine(hash, scores_[lane]);
+            return hash;
+        }
+
+        void Update()
+        {
+            if (elapsedTime_ >= endTime_)
+                return;
+
+            ++elapsedTime_;
+
+            if (elapsedTime_ % 3 == 0)
+            {
+                for (std::size_t lane = 0; lane < kLanes; ++lane)
+                {
+                    if (actions_[lane].empty())
+                        continue;
+
+                    ApplyAction(lane, actions_[lane].front());
+                    actions_[lane].pop();
+                }
+            }
+
+            for (int row = 1; row <= TConfig::kBoardHeight; ++row)
+            {
+                for (int col = 1; col <= TConfig::kBoardWidth; ++col)
+                {
+                    int index = row * kPaddedWidth + col;
+                    if (outputDirections_[index] != 0)
+                    {
+                        UpdatePassOne(index);
+                    }
+                }
+            }
+            for (int row = 1; row <= TConfig::kBoardHeight; ++row)
+            {
+                for (int col = 1; col <= TConfig::kBoardWidth; ++col)
+                {
+                    int index = row * kPaddedWidth + col;
+                    if (hasConveyor_[index])
+                    {
+                        UpdatePassTwo(index);
+                    }
+                }
+            }
+        }
+
+    private:
+        // The board gets a border of empty cells, so a neighbor is always a valid index and an
+        // off-board neighbor has no capacity.
+        static constexpr int kPaddedWidth = TConfig::kBoardWidth + 2;
+        static constexpr int kPaddedHeight = TConfig::kBoardHeight + 2;
+        static constexpr int kBufferSize = TConfig::kConveyorBufferSize;
+        // Top-left cell of the collection center, where GameManager puts it.
+        static constexpr CellPosition kCollectionCenterTopLeft{
+            static_cast<int>(TConfig::kBoardHeight / 2 - TConfig::kGoalSize / 2),
+            static_cast<int>(TConfig::kBoardWidth / 2 - TConfig::kGoalSize / 2)};
+        static constexpr std::int32_t kMiningInterval = 100;
+
+        enum Kind : std::int32_t
+        {
+            kEmpty,
+            kWall,
+            kCollectionCenter,
+            kConveyor,
+            kCombiner,
+            kMiningMachine,
+        };
+
+        // Index offsets of the neighbor in each Direction.
+        static constexpr int kNeighborOffsets[] = {-kPaddedWidth, 1, kPaddedWidth, -1};
+        // Index offsets from a combiner's main cell to its other cell, by output Direction.
+        static constexpr int kSecondCellOffsets[] = {-1, -kPaddedWidth, 1, kPaddedWidth};
+
+        using Lanes = std::int32_t[kLanes];
+
+        // A combiner keeps the product waiting in each of its cells in that cell's products[0], the
+        // slot a conveyor would expose first, so capacities and deliveries never need the other
+        // cell.
+        struct alignas(64) CellLanes
+        {
+            Lanes kind{};
+            Lanes direction{};
+            Lanes isMainCell{};
+            Lanes number{};
+            Lanes elapsedTime{};
+            Lanes products[kBufferSize]{};
+        };
+
+        static int GetIndex(CellPosition cellPosition)
+        {
+            return (cellPosition.row + 1) * kPaddedWidth + cellPosition.col + 1;
+        }
+
+        // Conditions in the lane loops are all-ones or zero masks combined with &, rather than bools
+        // combined with &&, which would branch and keep the loops from being vectorized.
+        static std::int32_t Mask(bool condition)
+        {
+            return condition ? -1 : 0;
+        }
+
+        static std::int32_t Select(std::int32_t mask, std::int32_t ifSet, std::int32_t ifClear)
+        {
+            return (ifSet & mask) | (ifClear & ~mask);
+        }
+
+        // What GetNeighborCapacity would return for a neighbor at `cell`, in every lane.
+        static void GetCapacities(const CellLanes &cell, Lanes &capacities)
+        {
+            Lanes conveyorCapacities;
+            for (std::size_t lane = 0; lane < kLanes; ++lane)
+            {
+                conveyorCapacities[lane] = kBufferSize;
+            }
+            for (int k = 0; k < kBufferSize; ++k)
+            {
+                for (std::size_t lane = 0; lane < kLanes; ++lane)
+                {
+                    conveyorCapacities[lane] = cell.products[k][lane] != 0 ? kBufferSize - 1 - k : conveyorCapacities[lane];
+                }
+            }
+
+            for (std::size_t lane = 0; lane < kLanes; ++lane)
+            {
+                std::int32_t kind = cell.kind[lane];
+                std::int32_t slotCapacity = cell.products[0][lane] == 0 ? kBufferSize : 0;
+                capacities[lane] =
+                    kind == kConveyor ? conveyorCapacities[lane]
+                    : kind == kCombiner ? slotCapacity
+                    : kind == kCollectionCenter ? kBufferSize
+                                                : 0;
+            }
+        }
+
+        void UpdatePassOne(int index)
+        {
+            CellLanes &cell = cells_[index];
+
+            for (int direction = 0; direction < 4; ++direction)
+            {
+                if ((outputDirections_[index] & (1 << direction)) == 0)
+                    continue;
+
+                CellLanes &neighbor = cells_[index + kNeighborOffsets[direction]];
+                CellLanes &secondCell = cells_[index + kSecondCellOffsets[direction]];
+
+                Lanes capacities;
+                GetCapacities(neighbor, capacities);
+
+                Lanes sent;
+                for (std::size_t lane = 0; lane < kLanes; ++lane)
+                {
+                    std::int32_t kind = cell.kind[lane];
+                    std::int32_t facing = Mask(cell.direction[lane] == direction);
+                    std::int32_t capacity = capacities[lane];
+                    std::int32_t output = 0;
+
+                    std::int32_t conveyor = facing & Mask(kind == kConveyor);
+                    std::int32_t first = cell.products[0][lane];
+                    std::int32_t second = cell.products[1][lane];
+                    std::int32_t third = cell.products[2][lane];
+
+                    std::int32_t send = conveyor & Mask(capacity >= 3) & Mask(first != 0);
+                    output = Select(send, first, output);
+                    first = Select(send, 0, first);
+
+                    std::int32_t shiftSecond = conveyor & Mask(capacity >= 2) & Mask(first == 0) & Mask(second != 0);
+                    first = Select(shiftSecond, second, first);
+                    second = Select(shiftSecond, 0, second);
+
+                    std::int32_t shiftThird = conveyor & Mask(capacity >= 1) & Mask(first == 0) & Mask(second == 0) & Mask(third != 0);
+                    second = Select(shiftThird, third, second);
+                    third = Select(shiftThird, 0, third);
+
+                    std::int32_t combiner = facing & Mask(kind == kCombiner) & Mask(cell.isMainCell[lane] != 0);
+                    std::int32_t otherSlot = secondCell.products[0][lane];
+                    std::int32_t combine = combiner & Mask(first != 0) & Mask(otherSlot != 0) & Mask(capacity >= 3);
+                    output = Select(combine, first + otherSlot, output);
+                    first = Select(combine, 0, first);
+                    otherSlot = Select(combine, 0, otherSlot);
+
+                    std::int32_t miningMachine = facing & Mask(kind == kMiningMachine);
+                    std::int32_t elapsedTime = cell.elapsedTime[lane] - miningMachine;
+                    std::int32_t due = miningMachine & Mask(elapsedTime >= kMiningInterval);
+                    std::int32_t mine = due & Mask(cell.number[lane] != 0) & Mask(capacity >= 3);
+                    output = Select(mine, cell.number[lane], output);
+                    elapsedTime = Select(due, 0, elapsedTime);
+
+                    cell.products[0][lane] = first;
+                    cell.products[1][lane] = second;
+                    cell.products[2][lane] = third;
+                    secondCell.products[0][lane] = otherSlot;
+                    cell.elapsedTime[lane] = elapsedTime;
+                    sent[lane] = output;
+                }
+
+                // Deliveries are rare enough to stay scalar.
+                for (std::size_t lane = 0; lane < kLanes; ++lane)
+                {
+                    if (sent[lane] != 0)
+                    {
+                        ReceiveProduct(neighbor, lane, sent[lane]);
+                    }
+                }
+            }
+        }
+
+        void UpdatePassTwo(int index)
+        {
+            CellLanes &cell = cells_[index];
+
+            for (int k = 3; k < kBufferSize; ++k)
+            {
+                for (std::size_t lane = 0; lane < kLanes; ++lane)
+                {
+                    std::int32_t product = cell.products[k][lane];
+                    std::int32_t move = Mask(cell.kind[lane] == kConveyor) & Mask(product != 0) &
+                                        Mask(cell.products[k - 1][lane] == 0) &
+                                        Mask(cell.products[k - 2][lane] == 0) &
+                                        Mask(cell.products[k - 3][lane] == 0);
+                    cell.products[k - 1][lane] = Select(move, product, cell.products[k - 1][lane]);
+                    cell.products[k][lane] = Select(move, 0, product);
+                }
+            }
+        }
+
+        void ReceiveProduct(CellLanes &cell, std::size_t lane, std::int32_t number)
+        {
+            switch (cell.kind[lane])
+            {
+            case kConveyor:
+                cell.products[kBufferSize - 1][lane] = number;
+                break;
+            case kCombiner:
+                cell.products[0][lane] = number;
+                break;
+            case kCollectionCenter:
+                if (number % commonDividors_[lane] == 0)
+                {
+                    ++scores_[lane];
+                }
+                break;
+            default:
+                break;
+            }
+        }
+
+        void ApplyAction(std::size_t lane, const PlayerAction &action)
+        {
+            switch (action.type)
+            {
+            case PlayerActionType::BuildLeftOutMiningMachine:
+                Build(lane, kMiningMachine, action.cellPosition, Direction::kLeft);
+                break;
+            case PlayerActionType::BuildTopOutMiningMachine:
+                Build(lane, kMiningMachine, action.cellPosition, Direction::kTop);
+                break;
+            case PlayerActionType::BuildRightOutMiningMachine:
+                Build(lane, kMiningMachine, action.cellPosition, Direction::kRight);
+                break;
+            case PlayerActionType::BuildBottomOutMiningMachine:
+                Build(lane, kMiningMachine, action.cellPosition, Direction::kBottom);
+                break;
+            case PlayerActionType::BuildLeftToRightConveyor:
+                Build(lane, kConveyor, action.cellPosition, Direction::kRight);
+                break;
+            case PlayerActionType::BuildTopToBottomConveyor:
+                Build(lane, kConveyor, action.cellPosition, Direction::kBottom);
+                break;
+            case PlayerActionType::BuildRightToLeftConveyor:
+                Build(lane, kConveyor, action.cellPosition, Direction::kLeft);
+                break;
+            case PlayerActionType::BuildBottomToTopConveyor:
+                Build(lane, kConveyor, action.cellPosition, Direction::kTop);
+                break;
+            case PlayerActionType::BuildTopOutCombiner:
+                Build(lane, kCombiner, action.cellPosition, Direction::kTop);
+                break;
+            case PlayerActionType::BuildRightOutCombiner:
+                Build(lane, kCombiner, action.cellPosition, Direction::kRight);
+                break;
+            case PlayerActionType::BuildBottomOutCombiner:
+                Build(lane, kCombiner, action.cellPosition, Direction::kBottom);
+                break;
+            case PlayerActionType::BuildLeftOutCombiner:
+                Build(lane, kCombiner, action.cellPosition, Direction::kLeft);
+                break;
+            case PlayerActionType::Clear:
+                Remove(lane, action.cellPosition);
+                break;
+            default:
+                break;
+            }
+        }
+
+        // Same footprints and rules as GameBoard::Build: every covered cell must be on the board
+        // and free of foreground entities.
+        void Build(std::size_t lane, Kind kind, CellPosition topLeft, Direction direction)
+        {
+            bool vertical = direction == Direction::kLeft || direction == Direction::kRight;
+            int width = kind == kCombiner && !vertical ? 2 : 1;
+            int height = kind == kCombiner && vertical ? 2 : 1;
+
+            if (topLeft.col < 0 || topLeft.col + width > TConfig::kBoardWidth ||
+                topLeft.row < 0 || topLeft.row + height > TConfig::kBoardHeight)
+                return;
+
+            for (int i = 0; i < height; ++i)
+            {
+                for (int j = 0; j < width; ++j)
+                {
+                    if (cells_[GetIndex(topLeft + CellPosition{i, j})].kind[lane] != kEmpty)
+                        return;
+                }
+            }
+
+            for (int i = 0; i < height; ++i)
+            {
+                for (int j = 0; j < width; ++j)
+                {
+                    int index = GetIndex(topLeft + CellPosition{i, j});
+                    bool isTopLeft = i == 0 && j == 0;
+                    bool mainIsTopLeft = direction == Direction::kBottom || direction == Direction::kLeft;
+
+                    SetCell(index, lane, kind, static_cast<int>(direction), kind == kCombiner && isTopLeft == mainIsTopLeft);
+                }
+            }
+        }
+
+        void Remove(std::size_t lane, CellPosition cellPosition)
+        {
+            if (cellPosition.row < 0 || cellPosition.row >= TConfig::kBoardHeight ||
+                cellPosition.col < 0 || cellPosition.col >= TConfig::kBoardWidth)
+                return;
+
+            int index = GetIndex(cellPosition);
+            const CellLanes &cell = cells_[index];
+            std::int32_t kind = cell.kind[lane];
+
+            if (kind != kConveyor && kind != kCombiner && kind != kMiningMachine)
+                return;
+
+            if (kind == kCombiner)
+            {
+                int offset = kSecondCellOffsets[cell.direction[lane]];
+                SetCell(cell.isMainCell[lane] ? index + offset : index - offset, lane, kEmpty, 0, false);
+            }
+            SetCell(index, lane, kEmpty, 0, false);
+        }
+
+        // A new entity starts empty, like a freshly constructed cell.
+        void SetCell(int index, std::size_t lane, std::int32_t kind, std::int32_t direction, bool isMainCell)
+        {
+            CellLanes &cell = cells_[index];
+            cell.kind[lane] = kind;
+            cell.direction[lane] = direction;
+            cell.isMainCell[lane] = isMainCell;
+            cell.elapsedTime[lane] = 0;
+            for (int k = 0; k < kBufferSize; ++k)
+            {
+                cell.products[k][lane] = 0;
+            }
+
+            // Which directions some lane sends products in, so the passes skip cells where no lane
+            // holds a working entity.
+            std::uint8_t outputDirections = 0;
+            bool hasConveyor = false;
+            for (std::size_t other = 0; other < kLanes; ++other)
+            {
+                std::int32_t otherKind = cell.kind[other];
+                if (otherKind == kConveyor || otherKind == kMiningMachine || (otherKind == kCombiner && cell.isMainCell[other]))
+                {
+                    outputDirections |= 1 << cell.direction[other];
+                }
+                hasConveyor = hasConveyor || otherKind == kConveyor;
+            }
+            outputDirections_[index] = outputDirections;
+            hasConveyor_[index] = hasConveyor;
+        }
+
+        std::size_t elapsedTime_;
+        std::size_t endTime_;
+        std::vector<CellLanes> cells_;
+        std::vector<std::uint8_t> outputDirections_;
+        std::vector<std::uint8_t> hasConveyor_;
+        std::array<int, kLanes> commonDividors_;
+        std::array<int, kLanes> scores_;
+        std::array<std::queue<PlayerAction>, kLanes> actions_;
+    };
+}
+#endif
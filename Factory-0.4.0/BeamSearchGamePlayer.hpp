@@ -0,0 +1,206 @@
+#ifndef BEAM_SEARCH_GAME_PLAYER_HPP
+#define BEAM_SEARCH_GAME_PLAYER_HPP
+#include <chrono>
+#include <vector>
+#include <queue>
+#include <memory>
+#include <algorithm>
+#include "PDOGS.cpp"
+#include "ConveyorRouter.hpp"
+#include "CombinerPlanner.hpp"
+#include "ScriptedGamePlayer.hpp"
+#include "ThreadPool.hpp"
+
+namespace Feis
+{
+    struct BeamSearchConfig
+    {
+        static constexpr std::size_t kBeamWidth = 3;
+        static constexpr std::size_t kBranching = 6;
+        static constexpr std::size_t kDepth = 2;
+        static constexpr std::size_t kLookaheadTicks = 200;
+        static constexpr int kTimeBudgetMilliseconds = 250;
+        static constexpr long long kDeliveryWeight = 10;
+    };
+
+    // Reference search player. Whenever its current layout is fully issued it forks the live game
+    // and runs a beam search over the layouts CombinerPlanner offers: every (beam node, layout) pair
+    // is simulated kLookaheadTicks past its last action on its own fork, as one task on the thread
+    // pool, and scored by deliveries plus scored products still in flight. The first layout of the
+    // best surviving line is then issued action by action. Lines whose simulation misses the time
+    // budget are dropped, so the result depends on machine speed once the budget is tight; if
+    // none finishes in time, the cheapest layout is issued.
+    template <typename TBeamSearchConfig = BeamSearchConfig>
+    class BeamSearchGamePlayer : public IGamePlayer
+    {
+    public:
+        BeamSearchGamePlayer(ThreadPool *pool) : pool_(pool) {}
+
+        PlayerAction GetNextAction(const IGameInfo &info) override
+        {
+            if (plan_.empty())
+            {
+                Search(info);
+            }
+
+            if (plan_.empty())
+            {
+                return {PlayerActionType::None, {0, 0}};
+            }
+
+            PlayerAction action = plan_.front();
+            plan_.pop();
+            return action;
+        }
+
+    private:
+        using Clock = std::chrono::steady_clock;
+
+        struct Node
+        {
+            std::unique_ptr<ScriptedGamePlayer> player;
+            std::unique_ptr<GameManager> game;
+            std::queue<PlayerAction> firstLayout;
+            long long score;
+        };
+
+        void Search(const IGameInfo &info)
+        {
+            Clock::time_point deadline = Clock::now() + std::chrono::milliseconds(TBeamSearchConfig::kTimeBudgetMilliseconds);
+
+            std::vector<std::unique_ptr<Node>> beam;
+            beam.push_back(std::make_unique<Node>());
+            beam[0]->player = std::make_unique<ScriptedGamePlayer>();
+            beam[0]->game = info.Fork(beam[0]->player.get());
+            beam[0]->score = 0;
+
+            for (std::size_t depth = 0; depth < TBeamSearchConfig::kDepth && Clock::now() < deadline; ++depth)
+            {
+                std::vector<std::vector<std::queue<PlayerAction>>> layouts(beam.size());
+
+                for (std::size_t i = 0; i < beam.size(); ++i)
+                {
+                    pool_->Submit([&, i]
+                                  { layouts[i] = GetCandidateLayouts(*beam[i]->game); });
+                }
+                pool_->Wait();
+
+                std::vector<std::pair<std::size_t, std::size_t>> expansions;
+                for (std::size_t i = 0; i < beam.size(); ++i)
+                {
+                    for (std::size_t j = 0; j < layouts[i].size(); ++j)
+                    {
+                        expansions.push_back({i, j});
+                    }
+                }
+
+                std::vector<std::unique_ptr<Node>> children(expansions.size());
+                for (std::size_t k = 0; k < expansions.size(); ++k)
+                {
+                    pool_->Submit([&, k]
+                                  {
+                                      const Node &parent = *beam[expansions[k].first];
+                                      const std::queue<PlayerAction> &layout = layouts[expansions[k].first][expansions[k].second];
+                                      children[k] = Expand(parent, layout, depth == 0 ? layout : parent.firstLayout, deadline); });
+                }
+                pool_->Wait();
+
+                children.erase(std::remove(children.begin(), children.end(), nullptr), children.end());
+                if (children.empty())
+                {
+                    // Nothing finished in time at the root: fall back to the cheapest layout.
+                    if (depth == 0 && !layouts[0].empty())
+                    {
+                        beam[0]->firstLayout = layouts[0][0];
+                    }
+                    break;
+                }
+
+                std::stable_sort(
+                    children.begin(),
+                    children.end(),
+                    [](const std::unique_ptr<Node> &lhs, const std::unique_ptr<Node> &rhs)
+                    { return lhs->score > rhs->score; });
+
+                if (children.size() > TBeamSearchConfig::kBeamWidth)
+                {
+                    children.resize(TBeamSearchConfig::kBeamWidth);
+                }
+                beam = std::move(children);
+            }
+
+            plan_ = beam[0]->firstLayout;
+        }
+
+        static std::vector<std::queue<PlayerAction>> GetCandidateLayouts(const GameManager &game)
+        {
+            ConveyorRouter router(game);
+            router.JoinConveyorLines(game);
+            CombinerPlanner planner(game);
+            std::vector<std::queue<PlayerAction>> layouts = planner.GetLayouts(game, router);
+
+            std::size_t count = std::min(layouts.size(), TBeamSearchConfig::kBranching);
+            std::partial_sort(
+                layouts.begin(),
+                layouts.begin() + count,
+                layouts.end(),
+                [](const std::queue<PlayerAction> &lhs, const std::queue<PlayerAction> &rhs)
+                { return lhs.size() < rhs.size(); });
+            layouts.resize(count);
+            return layouts;
+        }
+
+        static std::unique_ptr<Node> Expand(
+            const Node &parent,
+            const std::queue<PlayerAction> &layout,
+            const std::queue<PlayerAction> &firstLayout,
+            Clock::time_point deadline)
+        {
+            auto child = std::make_unique<Node>();
+            child->player = std::make_unique<ScriptedGamePlayer>(layout);
+            child->game = parent.game->Fork(child->player.get());
+            child->firstLayout = firstLayout;
+
+            std::size_t ticks = layout.size() * 3 + TBeamSearchConfig::kLookaheadTicks;
+            for (std::size_t t = 0; t < ticks && !child->game->IsGameOver(); ++t)
+            {
+                if (t % 64 == 0 && Clock::now() >= deadline)
+                    return nullptr;
+
+                child->game->Update();
+            }
+
+            child->score = Evaluate(*child->game);
+            return child;
+        }
+
+        static long long Evaluate(const GameManager &game)
+        {
+            long long productsInFlight = 0;
+
+            for (int row = 0; row < GameManagerConfig::kBoardHeight; ++row)
+            {
+                for (int col = 0; col < GameManagerConfig::kBoardWidth; ++col)
+                {
+                    auto foreground = game.GetLayeredCell({row, col}).GetForeground();
+                    if (foreground == nullptr || foreground->GetTopLeftCellPosition() != CellPosition{row, col})
+                        continue;
+
+                    for (int product : foreground->GetState().products)
+                    {
+                        if (product != 0 && game.IsScoredProduct(product))
+                        {
+                            ++productsInFlight;
+                        }
+                    }
+                }
+            }
+
+            return game.GetScores() * TBeamSearchConfig::kDeliveryWeight + productsInFlight;
+        }
+
+        ThreadPool *pool_;
+        std::queue<PlayerAction> plan_;
+    };
+}
+#endif
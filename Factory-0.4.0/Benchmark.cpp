@@ -0,0 +1,489 @@
+#define USE_HEADLESS
+#include <algorithm>
+#include <iostream>
+#include <chrono>
+#include <vector>
+#include <thread>
+
+#include "PDOGS.cpp"
+#include "ConveyorRouter.hpp"
+#include "CombinerPlanner.hpp"
+#include "ScriptedGamePlayer.hpp"
+#include "BatchedGameManager.hpp"
+#include "BatchedEngineRegistry.hpp"
+#include "ThreadPool.hpp"
+#include "DeliveryEventRing.hpp"
+
+using namespace Feis;
+
+// Plays every game to the end and returns the board-ticks per second.
+double RunSerial(int commonDividor, const std::vector<unsigned int> &seeds, const std::vector<std::queue<PlayerAction>> &plans, std::vector<int> &scores)
+{
+    auto startTime = std::chrono::steady_clock::now();
+
+    for (std::size_t k = 0; k < seeds.size(); ++k)
+    {
+        ScriptedGamePlayer player(plans[k]);
+        GameManager game(&player, commonDividor, seeds[k]);
+        while (!game.IsGameOver())
+        {
+            game.Update();
+        }
+        scores[k] = game.GetScores();
+    }
+
+    double seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - startTime).count();
+    return seeds.size() * GameManagerConfig::kEndTime / seconds;
+}
+
+template <std::size_t kLanes>
+double RunBatched(int commonDividor, const std::vector<unsigned int> &seeds, const std::vector<std::queue<PlayerAction>> &plans, std::vector<int> &scores)
+{
+    auto startTime = std::chrono::steady_clock::now();
+
+    for (std::size_t first = 0; first < seeds.size(); first += kLanes)
+    {
+        std::array<typename BatchedGameManager<kLanes>::LaneConfig, kLanes> lanes;
+        for (std::size_t lane = 0; lane < kLanes; ++lane)
+        {
+            lanes[lane] = {commonDividor, seeds[first + lane], plans[first + lane]};
+        }
+
+        BatchedGameManager<kLanes> batch(std::move(lanes));
+        while (!batch.IsGameOver())
+        {
+            batch.Update();
+        }
+
+        for (std::size_t lane = 0; lane < kLanes; ++lane)
+        {
+            scores[first + lane] = batch.GetScores(lane);
+        }
+    }
+
+    double seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - startTime).count();
+    return seeds.size() * GameManagerConfig::kEndTime / seconds;
+}
+
+// Plays greedy plans on consecutive seeds once per GameManager and once per lane of
+// BatchedGameManager, and compares throughput and scores.
+int RunLanes(int commonDividor, unsigned int firstSeed, std::size_t gameCount, bool sharedLayout)
+{
+    // Whole batches of the widest lane count.
+    gameCount = (gameCount + 15) / 16 * 16;
+
+    std::vector<unsigned int> seeds;
+    std::vector<std::queue<PlayerAction>> plans;
+    for (std::size_t k = 0; k < gameCount; ++k)
+    {
+        seeds.push_back(firstSeed + static_cast<unsigned int>(k));
+
+        ScriptedGamePlayer player;
+        GameManager game(&player, commonDividor, seeds.back());
+        ConveyorRouter router(game);
+        CombinerPlanner planner(game);
+        plans.push_back(k > 0 && sharedLayout ? plans.front() : planner.Plan(game, router, GameManagerConfig::kEndTime / 3));
+    }
+
+    std::vector<int> expected(gameCount);
+    double serial = RunSerial(commonDividor, seeds, plans, expected);
+    std::cout << "GameManager x" << gameCount << ": " << serial << " board-ticks/s" << std::endl;
+
+    auto report = [&](const char *name, double rate, const std::vector<int> &scores)
+    {
+        std::cout << name << ": " << rate << " board-ticks/s (" << rate / serial << "x), scores "
+                  << (scores == expected ? "match" : "DIFFER") << std::endl;
+    };
+
+    std::vector<int> scores(gameCount);
+    report("BatchedGameManager<8>", RunBatched<8>(commonDividor, seeds, plans, scores), scores);
+    report("BatchedGameManager<16>", RunBatched<16>(commonDividor, seeds, plans, scores), scores);
+    return 0;
+}
+
+// Plays one greedy plan with the serial update and with the striped parallel one, checks that the
+// two games hash equally after every tick, then times each on the finished layout.
+int RunStripes(int commonDividor, unsigned int seed, std::size_t stripeCount)
+{
+    ThreadPool pool;
+    if (stripeCount == 0)
+    {
+        stripeCount = std::max<std::size_t>(2 * pool.GetThreadCount(), 2);
+    }
+
+    auto parallelFor = [&pool](std::size_t count, const std::function<void(std::size_t)> &task)
+    {
+        for (std::size_t k = 0; k < count; ++k)
+        {
+            pool.Submit([&task, k]
+                        { task(k); });
+        }
+        pool.Wait();
+    };
+
+    std::queue<PlayerAction> plan;
+    {
+        ScriptedGamePlayer player;
+        GameManager game(&player, commonDividor, seed);
+        ConveyorRouter router(game);
+        CombinerPlanner planner(game);
+        plan = planner.Plan(game, router, GameManagerConfig::kEndTime / 3);
+    }
+
+    {
+        ScriptedGamePlayer serialPlayer(plan);
+        ScriptedGamePlayer stripedPlayer(plan);
+        GameManager serial(&serialPlayer, commonDividor, seed);
+        GameManager striped(&stripedPlayer, commonDividor, seed);
+        striped.EnableParallelUpdate(parallelFor, stripeCount);
+
+        while (!serial.IsGameOver())
+        {
+            serial.Update();
+            striped.Update();
+            if (serial.GetStateHash() != striped.GetStateHash())
+            {
+                std::cout << "States DIFFER after tick " << serial.GetElapsedTime() << std::endl;
+                return 1;
+            }
+        }
+        std::cout << "States match on all " << serial.GetElapsedTime() << " ticks, score " << serial.GetScores() << std::endl;
+    }
+
+    // The timed games start with the whole plan stamped, so every tick runs the finished factory.
+    std::vector<BlueprintCell> blueprint;
+    for (std::queue<PlayerAction> actions = plan; !actions.empty(); actions.pop())
+    {
+        BlueprintCell blueprintCell;
+        if (ToBlueprintCell(actions.front(), blueprintCell))
+        {
+            blueprint.push_back(blueprintCell);
+        }
+    }
+
+    auto time = [&](bool parallel)
+    {
+        ScriptedGamePlayer player;
+        GameManager game(&player, commonDividor, seed);
+        game.EnableSandbox(true);
+        game.StampBlueprint(blueprint);
+        if (parallel)
+        {
+            game.EnableParallelUpdate(parallelFor, stripeCount);
+        }
+
+        auto startTime = std::chrono::steady_clock::now();
+        while (!game.IsGameOver())
+        {
+            game.Update();
+        }
+        return GameManagerConfig::kEndTime / std::chrono::duration<double>(std::chrono::steady_clock::now() - startTime).count();
+    };
+
+    double serialRate = time(false);
+    double stripedRate = time(true);
+    std::cout << "Serial: " << serialRate << " ticks/s" << std::endl;
+    std::cout << stripeCount << " stripes on " << pool.GetThreadCount() << " threads: " << stripedRate
+              << " ticks/s (" << stripedRate / serialRate << "x)" << std::endl;
+    return 0;
+}
+
+// Plays one greedy plan with and without a reader thread draining deliveries from a ring, checks
+// that the reader saw every scored product, and times both.
+int RunEvents(int commonDividor, unsigned int seed)
+{
+    std::queue<PlayerAction> plan;
+    {
+        ScriptedGamePlayer player;
+        GameManager game(&player, commonDividor, seed);
+        ConveyorRouter router(game);
+        CombinerPlanner planner(game);
+        plan = planner.Plan(game, router, GameManagerConfig::kEndTime / 3);
+    }
+
+    auto play = [&](IDeliveryEventSink *sink)
+    {
+        ScriptedGamePlayer player(plan);
+        GameManager game(&player, commonDividor, seed);
+        game.SetDeliveryEventSink(sink);
+
+        auto startTime = std::chrono::steady_clock::now();
+        while (!game.IsGameOver())
+        {
+            game.Update();
+        }
+        double rate = GameManagerConfig::kEndTime / std::chrono::duration<double>(std::chrono::steady_clock::now() - startTime).count();
+        return std::make_pair(rate, game.GetScores());
+    };
+
+    auto ring = std::make_unique<DeliveryEventRing<4096>>();
+    std::atomic<bool> done{false};
+    std::size_t deliveries = 0;
+    int scored = 0;
+
+    std::thread reader([&]
+                       {
+                           DeliveryEvent event;
+                           while (true)
+                           {
+                               bool finished = done.load(std::memory_order_acquire);
+                               while (ring->TryPop(event))
+                               {
+                                   ++deliveries;
+                                   scored += event.scored;
+                               }
+                               if (finished)
+                                   return;
+                               std::this_thread::yield();
+                           }
+                       });
+
+    auto [silentRate, scores] = play(nullptr);
+    auto [ringRate, ringScores] = play(ring.get());
+    done.store(true, std::memory_order_release);
+    reader.join();
+
+    std::cout << "Without a sink: " << silentRate << " ticks/s, score " << scores << std::endl;
+    std::cout << "With a ring: " << ringRate << " ticks/s (" << ringRate / silentRate << "x), score " << ringScores << std::endl;
+    std::cout << "Reader saw " << deliveries << " deliveries, " << scored << " scored, "
+              << ring->GetDroppedCount() << " dropped" << std::endl;
+    return scored + static_cast<int>(ring->GetDroppedCount()) >= ringScores && ringScores == scores ? 0 : 1;
+}
+
+// Plays a greedy plan in sandbox games with every combiner slot depth and reports where the
+// combiners' time goes, so stalls can be weighed against the score deeper slots buy. Stamped miners
+// would all start on the same tick and feed every combiner in step, so only the rest of the plan is
+// stamped and the player builds the miners one action apart in a random order spread over about
+// one mining period, which lets the two inputs of a combiner drift apart.
+int RunCombiners(int commonDividor, unsigned int seed)
+{
+    std::queue<PlayerAction> plan;
+    {
+        ScriptedGamePlayer player;
+        GameManager game(&player, commonDividor, seed);
+        ConveyorRouter router(game);
+        CombinerPlanner planner(game);
+        plan = planner.Plan(game, router, GameManagerConfig::kEndTime / 3);
+    }
+
+    constexpr std::size_t kMinerSlots = 33;
+
+    std::vector<BlueprintCell> blueprint;
+    std::vector<std::pair<std::size_t, PlayerAction>> minerActions;
+    std::mt19937 random(seed);
+    for (std::queue<PlayerAction> actions = plan; !actions.empty(); actions.pop())
+    {
+        BlueprintCell blueprintCell;
+        if (!ToBlueprintCell(actions.front(), blueprintCell))
+            continue;
+
+        if (blueprintCell.type == BlueprintCellType::kMiningMachine)
+        {
+            minerActions.push_back({random() % kMinerSlots, actions.front()});
+        }
+        else
+        {
+            blueprint.push_back(blueprintCell);
+        }
+    }
+    std::stable_sort(minerActions.begin(), minerActions.end(), [](const auto &lhs, const auto &rhs)
+                     { return lhs.first < rhs.first; });
+
+    std::queue<PlayerAction> minerPlan;
+    for (const auto &[slot, action] : minerActions)
+    {
+        while (minerPlan.size() < slot)
+        {
+            minerPlan.push({PlayerActionType::None, {0, 0}});
+        }
+        minerPlan.push(action);
+    }
+
+    for (std::size_t inputDepth = 1; inputDepth <= CombinerCell::kMaxInputDepth; ++inputDepth)
+    {
+        ScriptedGamePlayer player(minerPlan);
+        GameManager game(&player, commonDividor, seed);
+        game.EnableSandbox(true);
+        game.SetCombinerInputDepth(inputDepth);
+        game.StampBlueprint(blueprint);
+
+        while (!game.IsGameOver())
+        {
+            game.Update();
+        }
+
+        std::vector<GameManager::CombinerReport> reports = game.GetCombinerReports();
+        CombinerStats total;
+        for (const GameManager::CombinerReport &report : reports)
+        {
+            total.combinedCount += report.stats.combinedCount;
+            total.idleTicks += report.stats.idleTicks;
+            total.waitingForFirstTicks += report.stats.waitingForFirstTicks;
+            total.waitingForSecondTicks += report.stats.waitingForSecondTicks;
+            total.outletBlockedTicks += report.stats.outletBlockedTicks;
+            total.firstSlotFullTicks += report.stats.firstSlotFullTicks;
+            total.secondSlotFullTicks += report.stats.secondSlotFullTicks;
+            total.heldProductTicks += report.stats.heldProductTicks;
+        }
+
+        double ticks = std::max<double>(reports.size() * GameManagerConfig::kEndTime, 1);
+        std::cout << "Depth " << inputDepth << ": score " << game.GetScores() << ", " << reports.size()
+                  << " combiners, " << total.combinedCount << " combined; idle " << 100 * total.idleTicks / ticks
+                  << "%, waiting on one input " << 100 * (total.waitingForFirstTicks + total.waitingForSecondTicks) / ticks
+                  << "%, outlet blocked " << 100 * total.outletBlockedTicks / ticks
+                  << "%, input line stopped " << 100 * (total.firstSlotFullTicks + total.secondSlotFullTicks) / (2 * ticks)
+                  << "%, mean wait " << total.heldProductTicks / std::max<double>(2 * total.combinedCount, 1) << " ticks"
+                  << std::endl;
+    }
+    return 0;
+}
+
+// A layout that works on a board of any shape: two conveyor spokes run into each side of the
+// collection center along its outer rows and columns, out to the first cell they cannot take, and a
+// miner goes on every scoring ore beside a spoke, facing it. The planner needs a GameManager, which
+// only exists at the judged shape, so the board is read through the shape's reference game.
+std::queue<PlayerAction> MakeSpokeLayout(const IReferenceGame &board, EngineShape shape, int commonDividor)
+{
+    struct Spoke
+    {
+        CellPosition start;
+        CellPosition step;
+        PlayerActionType conveyor;
+    };
+
+    int goalSize = static_cast<int>(GameManagerConfig::kGoalSize);
+    int top = shape.height / 2 - goalSize / 2;
+    int left = shape.width / 2 - goalSize / 2;
+    int bottom = top + goalSize - 1;
+    int right = left + goalSize - 1;
+    const Spoke spokes[] = {
+        {{top - 1, left}, {-1, 0}, PlayerActionType::BuildTopToBottomConveyor},
+        {{top - 1, right}, {-1, 0}, PlayerActionType::BuildTopToBottomConveyor},
+        {{bottom + 1, left}, {1, 0}, PlayerActionType::BuildBottomToTopConveyor},
+        {{bottom + 1, right}, {1, 0}, PlayerActionType::BuildBottomToTopConveyor},
+        {{top, left - 1}, {0, -1}, PlayerActionType::BuildLeftToRightConveyor},
+        {{bottom, left - 1}, {0, -1}, PlayerActionType::BuildLeftToRightConveyor},
+        {{top, right + 1}, {0, 1}, PlayerActionType::BuildRightToLeftConveyor},
+        {{bottom, right + 1}, {0, 1}, PlayerActionType::BuildRightToLeftConveyor},
+    };
+
+    std::vector<bool> claimed(shape.width * shape.height);
+    auto isFree = [&](CellPosition cellPosition)
+    {
+        return board.CanBuild(cellPosition) && !claimed[cellPosition.row * shape.width + cellPosition.col];
+    };
+
+    std::queue<PlayerAction> actions;
+    std::vector<std::pair<CellPosition, CellPosition>> spokeCells;
+    for (const Spoke &spoke : spokes)
+    {
+        for (CellPosition cellPosition = spoke.start; isFree(cellPosition); cellPosition = cellPosition + spoke.step)
+        {
+            claimed[cellPosition.row * shape.width + cellPosition.col] = true;
+            actions.push({spoke.conveyor, cellPosition});
+            spokeCells.push_back({cellPosition, spoke.step});
+        }
+    }
+
+    for (const auto &[cellPosition, step] : spokeCells)
+    {
+        for (int side : {-1, 1})
+        {
+            CellPosition offset{step.col * side, step.row * side};
+            CellPosition miner = cellPosition + offset;
+            if (!isFree(miner) || board.GetNumber(miner) == 0 || board.GetNumber(miner) % commonDividor != 0)
+                continue;
+
+            Direction direction = offset.row < 0 ? Direction::kBottom : offset.row > 0 ? Direction::kTop
+                                                                      : offset.col < 0   ? Direction::kRight
+                                                                                         : Direction::kLeft;
+            claimed[miner.row * shape.width + miner.col] = true;
+            actions.push({ConveyorRouter::GetMiningMachineActionType(direction), miner});
+        }
+    }
+    return actions;
+}
+
+// Plays kLanes games of spoke layouts on every prebuilt engine shape, to compare how the update
+// scales with the board and buffer size.
+int RunShapes(int commonDividor, unsigned int firstSeed)
+{
+    for (const BatchedEngineRegistry::Entry &entry : BatchedEngineRegistry::GetEntries())
+    {
+        EngineShape shape = entry.shape;
+
+        std::vector<BatchedLaneConfig> lanes;
+        std::size_t actionCount = 0;
+        for (std::size_t lane = 0; lane < BatchedEngineRegistry::kLanes; ++lane)
+        {
+            BatchedLaneConfig laneConfig{commonDividor, firstSeed + static_cast<unsigned int>(lane), {}};
+            laneConfig.actions = MakeSpokeLayout(*entry.createReference(laneConfig), shape, commonDividor);
+            actionCount += laneConfig.actions.size();
+            lanes.push_back(std::move(laneConfig));
+        }
+
+        std::unique_ptr<IBatchedEngine> engine = BatchedEngineRegistry::Create(shape, std::move(lanes));
+
+        auto startTime = std::chrono::steady_clock::now();
+        while (!engine->IsGameOver())
+        {
+            engine->Update();
+        }
+        double seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - startTime).count();
+
+        int scores = 0;
+        for (std::size_t lane = 0; lane < engine->GetLaneCount(); ++lane)
+        {
+            scores += engine->GetScores(lane);
+        }
+
+        double laneCount = static_cast<double>(engine->GetLaneCount());
+        double boardTicks = laneCount * GameManagerConfig::kEndTime / seconds;
+        std::cout << shape.width << "x" << shape.height << ", buffer " << shape.bufferSize << ": "
+                  << boardTicks << " board-ticks/s, " << boardTicks * shape.width * shape.height
+                  << " cell-ticks/s, " << actionCount / laneCount << " entities and score "
+                  << scores / laneCount << " per game" << std::endl;
+    }
+    return 0;
+}
+
+int main(int argc, char **argv)
+{
+    std::string mode = argc > 1 ? argv[1] : "";
+
+    if (mode == "lanes" && argc >= 4)
+    {
+        // A seed sweep plays the first seed's layout on every seed; "own" plans each seed separately,
+        // which leaves the lanes little in common.
+        return RunLanes(std::stoi(argv[2]), static_cast<unsigned int>(std::stoul(argv[3])),
+                        argc > 4 ? std::stoul(argv[4]) : 64, argc <= 5 || std::string(argv[5]) != "own");
+    }
+
+    if (mode == "stripes" && argc >= 4)
+    {
+        return RunStripes(std::stoi(argv[2]), static_cast<unsigned int>(std::stoul(argv[3])),
+                          argc > 4 ? std::stoul(argv[4]) : 0);
+    }
+
+    if (mode == "events" && argc >= 4)
+    {
+        return RunEvents(std::stoi(argv[2]), static_cast<unsigned int>(std::stoul(argv[3])));
+    }
+
+    if (mode == "combiners" && argc >= 4)
+    {
+        return RunCombiners(std::stoi(argv[2]), static_cast<unsigned int>(std::stoul(argv[3])));
+    }
+
+    if (mode == "shapes" && argc >= 4)
+    {
+        return RunShapes(std::stoi(argv[2]), static_cast<unsigned int>(std::stoul(argv[3])));
+    }
+
+    std::cout << "Usage: Benchmark lanes <divisor> <first seed> [games] [shared|own]" << std::endl;
+    std::cout << "       Benchmark stripes <divisor> <seed> [stripes]" << std::endl;
+    std::cout << "       Benchmark events <divisor> <seed>" << std::endl;
+    std::cout << "       Benchmark combiners <divisor> <seed>" << std::endl;
+    std::cout << "       Benchmark shapes <divisor> <first seed>" << std::endl;
+    return 1;
+}
@@ -0,0 +1,146 @@
+#ifndef BOARD_SUMMARY_HPP
+#define BOARD_SUMMARY_HPP
+#include <cstdint>
+#include <vector>
+#include "PDOGS.cpp"
+
+// One byte per cell saying what occupies it: all a far-zoomed view can show, since a cell is then
+// only a few pixels wide. Products are left out, so the summary only changes with the board
+// version.
+class BoardSummary
+{
+public:
+    using GameManagerConfig = Feis::GameManagerConfig;
+    using CellPosition = Feis::CellPosition;
+
+    enum class Kind : std::uint8_t
+    {
+        kEmpty,
+        kNumber,
+        kScoredNumber,
+        kWall,
+        kMiningMachine,
+        kConveyor,
+        kCombiner,
+        kCollectionCenter,
+    };
+
+    BoardSummary()
+        : kinds_(GameManagerConfig::kBoardHeight * GameManagerConfig::kBoardWidth, Kind::kEmpty),
+          version_{}, valid_{false}
+    {
+    }
+
+    // Rebuilds the summary if the board changed since the last call; returns whether it did.
+    bool Update(const Feis::IGameInfo &info)
+    {
+        if (valid_ && version_ == info.GetBoardVersion())
+            return false;
+
+        for (int row = 0; row < GameManagerConfig::kBoardHeight; ++row)
+        {
+            for (int col = 0; col < GameManagerConfig::kBoardWidth; ++col)
+            {
+                const auto &layeredCell = info.GetLayeredCell({row, col});
+                Kind &kind = kinds_[row * GameManagerConfig::kBoardWidth + col];
+                kind = Kind::kEmpty;
+
+                KindVisitor visitor(&info, &kind);
+                if (auto foreground = layeredCell.GetForeground())
+                {
+                    foreground->Accept(&visitor);
+                }
+                else if (auto background = layeredCell.GetBackground())
+                {
+                    background->Accept(&visitor);
+                }
+            }
+        }
+
+        version_ = info.GetBoardVersion();
+        valid_ = true;
+        return true;
+    }
+
+    void Invalidate()
+    {
+        valid_ = false;
+    }
+
+    Kind Get(CellPosition cellPosition) const
+    {
+        return kinds_[cellPosition.row * GameManagerConfig::kBoardWidth + cellPosition.col];
+    }
+
+    // Roughly the colour the full passes give a cell of that kind.
+    static sf::Color GetColor(Kind kind)
+    {
+        switch (kind)
+        {
+        case Kind::kNumber:
+            return sf::Color(150, 150, 150);
+        case Kind::kScoredNumber:
+            return sf::Color(60, 200, 60);
+        case Kind::kWall:
+            return sf::Color(60, 60, 60);
+        case Kind::kMiningMachine:
+            return sf::Color(128, 0, 0);
+        case Kind::kConveyor:
+            return sf::Color(128, 128, 128);
+        case Kind::kCombiner:
+            return sf::Color(200, 200, 200);
+        case Kind::kCollectionCenter:
+            return sf::Color(0, 0, 180);
+        default:
+            return sf::Color::Black;
+        }
+    }
+
+private:
+    class KindVisitor : public Feis::CellVisitor
+    {
+    public:
+        KindVisitor(const Feis::IGameInfo *info, Kind *kind) : info_(info), kind_(kind)
+        {
+        }
+
+        void Visit(const Feis::NumberCell *cell) const override
+        {
+            *kind_ = info_->IsScoredProduct(cell->GetNumber()) ? Kind::kScoredNumber : Kind::kNumber;
+        }
+
+        void Visit(const Feis::CollectionCenterCell *cell) const override
+        {
+            *kind_ = Kind::kCollectionCenter;
+        }
+
+        void Visit(const Feis::MiningMachineCell *cell) const override
+        {
+            *kind_ = Kind::kMiningMachine;
+        }
+
+        void Visit(const Feis::ConveyorCell *cell) const override
+        {
+            *kind_ = Kind::kConveyor;
+        }
+
+        void Visit(const Feis::CombinerCell *cell) const override
+        {
+            *kind_ = Kind::kCombiner;
+        }
+
+        void Visit(const Feis::WallCell *cell) const override
+        {
+            *kind_ = Kind::kWall;
+        }
+
+    private:
+        const Feis::IGameInfo *info_;
+        Kind *kind_;
+    };
+
+    std::vector<Kind> kinds_;
+    std::size_t version_;
+    bool valid_;
+};
+#endif
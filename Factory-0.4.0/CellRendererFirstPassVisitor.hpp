@@ -1,9 +1,10 @@
 #ifndef CELL_RENDERER_FIRST_PASS_VISITOR_HPP
 #define CELL_RENDERER_FIRST_PASS_VISITOR_HPP
+#include <unordered_map>
 #include "PDOGS.cpp"
 #include "Drawer.hpp"
 
-template <typename TGameRendererConfig>
+template <typename TGameRendererConfig, typename TDrawer = Drawer<TGameRendererConfig>>
 class CellRendererFirstPassVisitor : public Feis::CellVisitor
 {
 public:
@@ -13,7 +14,7 @@ public:
 
     CellRendererFirstPassVisitor(
         const Feis::IGameInfo *info,
-        Drawer<TGameRendererConfig> *drawer,
+        TDrawer *drawer,
         CellPosition cellPosition,
         IBackgroundCell *backgroundCell)
         : info{info}, drawer_(drawer), cellPosition_(cellPosition), backgroundCell_(backgroundCell)
@@ -30,17 +31,11 @@ public:
         drawer_->DrawBorder(cellPosition_);
 
         int number = cell->GetNumber();
-        std::mt19937 gen(number);
-        std::uniform_int_distribution<int> dis(0, 50);
-        int r = dis(gen) + 128;
-        int g = dis(gen) + 128;
-        int b = dis(gen) + 128;
-        sf::Color color(r, g, b);
 
         drawer_->DrawText(
             std::to_string(number),
             TGameRendererConfig::kCellSize * 0.75f,
-            color,
+            GetNumberColor(number),
             cellPosition_);
     }
 
@@ -83,8 +78,27 @@ public:
         drawer_->DrawBorder(cellPosition_);
     }
 private:
+    static sf::Color GetNumberColor(int number)
+    {
+        static std::unordered_map<int, sf::Color> colors;
+
+        auto it = colors.find(number);
+        if (it != colors.end())
+            return it->second;
+
+        std::mt19937 gen(number);
+        std::uniform_int_distribution<int> dis(0, 50);
+        int r = dis(gen) + 128;
+        int g = dis(gen) + 128;
+        int b = dis(gen) + 128;
+        sf::Color color(r, g, b);
+
+        colors.emplace(number, color);
+        return color;
+    }
+
     const Feis::IGameInfo *info;
-    Drawer<TGameRendererConfig> *drawer_;
+    TDrawer *drawer_;
     CellPosition cellPosition_;
     IBackgroundCell *backgroundCell_;
 };
@@ -1,8 +1,9 @@
 #ifndef CELL_RENDERER_SECOND_PASS_VISITOR_HPP
 #define CELL_RENDERER_SECOND_PASS_VISITOR_HPP
 #include "PDOGS.cpp"
+#include "Drawer.hpp"
 
-template <typename TGameRendererConfig>
+template <typename TGameRendererConfig, typename TDrawer = Drawer<TGameRendererConfig>>
 class CellRendererSecondPassVisitor : public Feis::CellVisitor
 {
 public:
@@ -11,7 +12,7 @@ public:
 
     CellRendererSecondPassVisitor(
         const Feis::IGameInfo* info,
-        Drawer<TGameRendererConfig> *drawer, 
+        TDrawer *drawer, 
         CellPosition cellPosition)
         : info(info), drawer_(drawer), cellPosition_(cellPosition)
     {
@@ -67,7 +68,7 @@ public:
     }
 private:
     const Feis::IGameInfo *info;
-    Drawer<TGameRendererConfig> *drawer_;
+    TDrawer *drawer_;
     CellPosition cellPosition_;
 };
 #endif
\ No newline at end of file
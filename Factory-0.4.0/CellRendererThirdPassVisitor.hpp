@@ -1,8 +1,9 @@
 #ifndef CELL_RENDERER_THIRD_PASS_VISITOR_HPP
 #define CELL_RENDERER_THIRD_PASS_VISITOR_HPP
 #include "PDOGS.cpp"
+#include "Drawer.hpp"
 
-template <typename TGameRendererConfig>
+template <typename TGameRendererConfig, typename TDrawer = Drawer<TGameRendererConfig>>
 class CellRendererThirdPassVisitor : public Feis::CellVisitor
 {
 public:
@@ -11,7 +12,7 @@ public:
 
     CellRendererThirdPassVisitor(
         const Feis::IGameInfo* info,
-        Drawer<TGameRendererConfig> *drawer, 
+        TDrawer *drawer, 
         CellPosition cellPosition)
         : info_(info), drawer_(drawer), cellPosition_(cellPosition)
     {
@@ -21,12 +22,10 @@ public:
        if (cellPosition_ != cell->GetTopLeftCellPosition())
             return;
 
-        sf::RectangleShape rectangle(
-            sf::Vector2f(TGameRendererConfig::kCellSize * cell->GetWidth(), TGameRendererConfig::kCellSize * cell->GetHeight()));
-
-        rectangle.setFillColor(sf::Color(0, 0, 180));
-        rectangle.setPosition(drawer_->GetCellTopLeft(cellPosition_));
-        drawer_->DrawShape(rectangle);
+        drawer_->DrawRectangle(
+            drawer_->GetCellTopLeft(cellPosition_),
+            sf::Vector2f(TGameRendererConfig::kCellSize * cell->GetWidth(), TGameRendererConfig::kCellSize * cell->GetHeight()),
+            sf::Color(0, 0, 180));
 
         sf::Vector2f scoreTextPosition =
             drawer_->GetCellTopLeft(cell->GetTopLeftCellPosition()) +
@@ -71,7 +70,7 @@ public:
 
 private:
     const Feis::IGameInfo *info_;
-    Drawer<TGameRendererConfig> * const drawer_;
+    TDrawer * const drawer_;
     CellPosition cellPosition_;
 };
 #endif
\ No newline at end of file
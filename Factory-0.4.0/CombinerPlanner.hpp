@@ -0,0 +1,285 @@
+#ifndef COMBINER_PLANNER_HPP
+#define COMBINER_PLANNER_HPP
+#include <vector>
+#include <queue>
+#include <set>
+#include <algorithm>
+#include "PDOGS.cpp"
+#include "ConveyorRouter.hpp"
+
+namespace Feis
+{
+    // Plans factories in which every delivered product scores. Ore sites are indexed by their
+    // residue modulo the level's divisor; a site whose residue is zero feeds the collection center
+    // directly, and two adjacent sites whose residues add up to zero feed a combiner.
+    class CombinerPlanner
+    {
+    public:
+        static constexpr int kMaxDivisor = 1000;
+        static constexpr std::size_t kMaxRecipeSize = 4;
+
+        CombinerPlanner(const IGameInfo &info) : divisor_{1}
+        {
+            while (divisor_ < kMaxDivisor && !info.IsScoredProduct(divisor_))
+            {
+                ++divisor_;
+            }
+
+            sites_.resize(divisor_);
+
+            for (int row = 0; row < GameManagerConfig::kBoardHeight; ++row)
+            {
+                for (int col = 0; col < GameManagerConfig::kBoardWidth; ++col)
+                {
+                    const LayeredCell &layeredCell = info.GetLayeredCell({row, col});
+                    auto numberCell = dynamic_cast<const NumberCell *>(layeredCell.GetBackground().get());
+
+                    if (numberCell && layeredCell.CanBuild())
+                    {
+                        sites_[numberCell->GetNumber() % divisor_].push_back({row, col});
+                        numbers_.insert(numberCell->GetNumber());
+                    }
+                }
+            }
+        }
+
+        int GetDivisor() const { return divisor_; }
+
+        const std::vector<CellPosition> &GetSites(int residue) const { return sites_[residue]; }
+
+        // Every multiset of at most maxSize ore values on the board whose sum scores, smallest first.
+        // A recipe with n values is a tree of n - 1 combiners.
+        std::vector<std::vector<int>> GetRecipes(std::size_t maxSize = kMaxRecipeSize) const
+        {
+            std::vector<std::vector<int>> recipes;
+            std::vector<int> numbers(numbers_.begin(), numbers_.end());
+            std::vector<int> recipe;
+
+            for (std::size_t size = 1; size <= maxSize; ++size)
+            {
+                CollectRecipes(numbers, 0, size, 0, recipe, recipes);
+            }
+            return recipes;
+        }
+
+        // Every single-miner and miner-pair-plus-combiner layout that can currently be built, each as
+        // the actions that build it.
+        std::vector<std::queue<PlayerAction>> GetLayouts(const IGameInfo &info, const ConveyorRouter &router) const
+        {
+            std::vector<std::queue<PlayerAction>> layouts;
+
+            for (CellPosition site : sites_[0])
+            {
+                std::queue<PlayerAction> layout = router.PlanRoute(info, site);
+                if (!layout.empty())
+                {
+                    layouts.push_back(std::move(layout));
+                }
+            }
+
+            for (int residue = 1; residue < divisor_; ++residue)
+            {
+                int complement = (divisor_ - residue) % divisor_;
+                if (complement < residue)
+                    continue;
+
+                // The complement may lie on any side. When both residues are the same, looking right
+                // and down alone finds every pair once.
+                for (CellPosition site : sites_[residue])
+                {
+                    for (CellPosition offset : {CellPosition{0, 1}, CellPosition{1, 0}, CellPosition{0, -1}, CellPosition{-1, 0}})
+                    {
+                        bool backward = offset.row < 0 || offset.col < 0;
+                        if (backward && complement == residue)
+                            continue;
+
+                        CellPosition neighbor = site + offset;
+                        if (!IsWithinBoard(neighbor) || !IsSite(info, neighbor, complement))
+                            continue;
+
+                        CellPosition first = backward ? neighbor : site;
+                        CellPosition second = backward ? site : neighbor;
+                        for (int side = 0; side < 2; ++side)
+                        {
+                            std::queue<PlayerAction> layout;
+                            if (PlanCombinerLayout(router, first, second, offset.row == 0, side == 0, layout))
+                            {
+                                layouts.push_back(std::move(layout));
+                            }
+                        }
+                    }
+                }
+            }
+            return layouts;
+        }
+
+        // Marks the cells of a chosen layout in the router: entities are reserved and conveyors are
+        // joined, so later layouts route around the former and may feed into the latter.
+        static void Commit(const std::queue<PlayerAction> &layout, ConveyorRouter &router)
+        {
+            std::queue<PlayerAction> actions = layout;
+
+            while (!actions.empty())
+            {
+                const PlayerAction &action = actions.front();
+                if (IsConveyorAction(action.type))
+                {
+                    router.Join(action.cellPosition);
+                }
+                else
+                {
+                    router.Reserve(action.cellPosition);
+                }
+
+                if (action.type == PlayerActionType::BuildBottomOutCombiner ||
+                    action.type == PlayerActionType::BuildTopOutCombiner)
+                {
+                    router.Reserve(action.cellPosition + CellPosition{0, 1});
+                }
+                else if (action.type == PlayerActionType::BuildRightOutCombiner ||
+                         action.type == PlayerActionType::BuildLeftOutCombiner)
+                {
+                    router.Reserve(action.cellPosition + CellPosition{1, 0});
+                }
+                actions.pop();
+            }
+        }
+
+        // Greedily commits up to maxLayouts layouts, always the one needing the fewest actions.
+        std::queue<PlayerAction> Plan(const IGameInfo &info, ConveyorRouter &router, std::size_t maxLayouts) const
+        {
+            std::queue<PlayerAction> plan;
+
+            for (std::size_t k = 0; k < maxLayouts; ++k)
+            {
+                std::vector<std::queue<PlayerAction>> layouts = GetLayouts(info, router);
+                if (layouts.empty())
+                    break;
+
+                auto best = std::min_element(
+                    layouts.begin(),
+                    layouts.end(),
+                    [](const std::queue<PlayerAction> &lhs, const std::queue<PlayerAction> &rhs)
+                    { return lhs.size() < rhs.size(); });
+
+                Commit(*best, router);
+
+                while (!best->empty())
+                {
+                    plan.push(best->front());
+                    best->pop();
+                }
+            }
+            return plan;
+        }
+
+    private:
+        static bool IsConveyorAction(PlayerActionType type)
+        {
+            return type == PlayerActionType::BuildLeftToRightConveyor ||
+                   type == PlayerActionType::BuildTopToBottomConveyor ||
+                   type == PlayerActionType::BuildRightToLeftConveyor ||
+                   type == PlayerActionType::BuildBottomToTopConveyor;
+        }
+
+        bool IsSite(const IGameInfo &info, CellPosition cellPosition, int residue) const
+        {
+            auto numberCell =
+                dynamic_cast<const NumberCell *>(info.GetLayeredCell(cellPosition).GetBackground().get());
+            return numberCell && numberCell->GetNumber() % divisor_ == residue;
+        }
+
+        void CollectRecipes(
+            const std::vector<int> &numbers,
+            std::size_t first,
+            std::size_t size,
+            int sum,
+            std::vector<int> &recipe,
+            std::vector<std::vector<int>> &recipes) const
+        {
+            if (recipe.size() == size)
+            {
+                if (sum % divisor_ == 0)
+                {
+                    recipes.push_back(recipe);
+                }
+                return;
+            }
+
+            for (std::size_t i = first; i < numbers.size(); ++i)
+            {
+                recipe.push_back(numbers[i]);
+                CollectRecipes(numbers, i, size, sum + numbers[i], recipe, recipes);
+                recipe.pop_back();
+            }
+        }
+
+        // Two adjacent sites mine into the input cells of a combiner placed beside them, and the
+        // combiner output is routed to the collection center. `horizontal` means second is right of
+        // first; `before` places the combiner above (or left of) the pair instead of below (or right).
+        static bool PlanCombinerLayout(
+            const ConveyorRouter &router,
+            CellPosition first,
+            CellPosition second,
+            bool horizontal,
+            bool before,
+            std::queue<PlayerAction> &actions)
+        {
+            Direction direction = horizontal ? (before ? Direction::kTop : Direction::kBottom)
+                                             : (before ? Direction::kLeft : Direction::kRight);
+
+            CellPosition firstInput = GetNeighborCellPosition(first, direction);
+            CellPosition secondInput = GetNeighborCellPosition(second, direction);
+            CellPosition topLeft = firstInput;
+            CellPosition mainCell = direction == Direction::kTop || direction == Direction::kRight ? secondInput : firstInput;
+            CellPosition output = GetNeighborCellPosition(mainCell, direction);
+
+            for (CellPosition cellPosition : {first, second, firstInput, secondInput})
+            {
+                if (!IsWithinBoard(cellPosition) || !router.IsAvailable(cellPosition))
+                    return false;
+            }
+
+            std::queue<PlayerAction> path;
+            if (!router.AppendPath(output, path))
+                return false;
+
+            PlayerActionType combinerType;
+            switch (direction)
+            {
+            case Direction::kTop:
+                combinerType = PlayerActionType::BuildTopOutCombiner;
+                break;
+            case Direction::kRight:
+                combinerType = PlayerActionType::BuildRightOutCombiner;
+                break;
+            case Direction::kBottom:
+                combinerType = PlayerActionType::BuildBottomOutCombiner;
+                break;
+            case Direction::kLeft:
+                combinerType = PlayerActionType::BuildLeftOutCombiner;
+                break;
+            }
+
+            actions.push({combinerType, topLeft});
+            actions.push({ConveyorRouter::GetMiningMachineActionType(direction), first});
+            actions.push({ConveyorRouter::GetMiningMachineActionType(direction), second});
+
+            while (!path.empty())
+            {
+                CellPosition cellPosition = path.front().cellPosition;
+                if (cellPosition == first || cellPosition == second || cellPosition == firstInput || cellPosition == secondInput)
+                    return false;
+
+                actions.push(path.front());
+                path.pop();
+            }
+            return true;
+        }
+
+        int divisor_;
+        std::set<int> numbers_;
+        std::vector<std::vector<CellPosition>> sites_;
+    };
+}
+#endif
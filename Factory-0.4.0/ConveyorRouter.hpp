@@ -0,0 +1,491 @@
+#ifndef CONVEYOR_ROUTER_HPP
+#define CONVEYOR_ROUTER_HPP
+#include <vector>
+#include <array>
+#include <algorithm>
+#include <queue>
+#include <limits>
+#include <functional>
+#include "PDOGS.cpp"
+
+namespace Feis
+{
+    // Distance field from every buildable cell to the nearest CollectionCenterCell.
+    // A cell's distance is the number of conveyors needed to carry a product from it into the
+    // collection center. Walls and existing entities are obstacles; the field is repaired
+    // locally whenever a cell changes instead of being recomputed for the whole board.
+    class ConveyorRouter
+    {
+    public:
+        static constexpr int kUnreachable = std::numeric_limits<int>::max();
+
+        ConveyorRouter(const IGameInfo &info)
+            : kinds_(kCellCount, CellKind::kBlocked), reserved_(kCellCount, false), joined_(kCellCount, false), distances_(kCellCount, kUnreachable)
+        {
+            std::queue<int> frontier;
+
+            for (int row = 0; row < GameManagerConfig::kBoardHeight; ++row)
+            {
+                for (int col = 0; col < GameManagerConfig::kBoardWidth; ++col)
+                {
+                    int index = GetIndex({row, col});
+                    kinds_[index] = ReadCellKind(info, {row, col});
+                }
+            }
+
+            for (int index = 0; index < kCellCount; ++index)
+            {
+                if (IsSink(index))
+                {
+                    distances_[index] = 0;
+                    frontier.push(index);
+                }
+            }
+
+            Propagate(frontier);
+        }
+
+        int GetDistance(CellPosition cellPosition) const
+        {
+            return distances_[GetIndex(cellPosition)];
+        }
+
+        bool IsReachable(CellPosition cellPosition) const
+        {
+            return GetDistance(cellPosition) != kUnreachable;
+        }
+
+        // Re-reads one cell from the board and repairs the field if the cell changed. A cell that
+        // was built on and is free again lost whatever was reserved or joined there, so it stops
+        // being a sink.
+        void OnCellChanged(const IGameInfo &info, CellPosition cellPosition)
+        {
+            int index = GetIndex(cellPosition);
+            CellKind kind = ReadCellKind(info, cellPosition);
+            if (kinds_[index] != kind)
+            {
+                if (kind == CellKind::kFree)
+                {
+                    reserved_[index] = false;
+                    joined_[index] = false;
+                }
+                kinds_[index] = kind;
+                Refresh(index);
+            }
+        }
+
+        // Builds and removals may span a 2-cell combiner, so every cell around the action is refreshed.
+        void OnActionApplied(const IGameInfo &info, const PlayerAction &action)
+        {
+            if (action.type == PlayerActionType::None)
+                return;
+
+            for (int dRow = -1; dRow <= 1; ++dRow)
+            {
+                for (int dCol = -1; dCol <= 1; ++dCol)
+                {
+                    CellPosition cellPosition = action.cellPosition + CellPosition{dRow, dCol};
+                    if (IsWithinBoard(cellPosition))
+                    {
+                        OnCellChanged(info, cellPosition);
+                    }
+                }
+            }
+        }
+
+        // Marks a cell as taken by a planned but not yet built entity so later routes avoid it.
+        void Reserve(CellPosition cellPosition)
+        {
+            int index = GetIndex(cellPosition);
+            if (reserved_[index])
+                return;
+
+            reserved_[index] = true;
+            Refresh(index);
+        }
+
+        // Marks a cell as part of a planned or built conveyor line into the collection center, so
+        // later routes may end by feeding into it.
+        void Join(CellPosition cellPosition)
+        {
+            int index = GetIndex(cellPosition);
+            if (joined_[index])
+                return;
+
+            joined_[index] = true;
+            Refresh(index);
+        }
+
+        // Joins every conveyor already on the board whose line ends in a collection center, so routes
+        // may feed into existing lines from the side.
+        void JoinConveyorLines(const IGameInfo &info)
+        {
+            enum class LineState
+            {
+                kUnknown,
+                kDeadEnd,
+                kLeadsToSink
+            };
+
+            std::vector<LineState> lineStates(kCellCount, LineState::kUnknown);
+            std::vector<int> line;
+
+            for (int index = 0; index < kCellCount; ++index)
+            {
+                line.clear();
+                LineState result = LineState::kDeadEnd;
+                int current = index;
+
+                while (true)
+                {
+                    if (kinds_[current] == CellKind::kSink)
+                    {
+                        result = LineState::kLeadsToSink;
+                        break;
+                    }
+                    if (lineStates[current] != LineState::kUnknown)
+                    {
+                        result = lineStates[current];
+                        break;
+                    }
+
+                    CellPosition cellPosition = GetCellPosition(current);
+                    auto conveyor =
+                        dynamic_cast<const ConveyorCell *>(info.GetLayeredCell(cellPosition).GetForeground().get());
+                    if (conveyor == nullptr)
+                        break;
+
+                    // Marked before following the line so that conveyor loops terminate.
+                    lineStates[current] = LineState::kDeadEnd;
+                    line.push_back(current);
+
+                    CellPosition next = GetNeighborCellPosition(cellPosition, conveyor->GetDirection());
+                    if (!IsWithinBoard(next))
+                        break;
+                    current = GetIndex(next);
+                }
+
+                for (int cell : line)
+                {
+                    lineStates[cell] = result;
+                    if (result == LineState::kLeadsToSink)
+                    {
+                        Join(GetCellPosition(cell));
+                    }
+                }
+            }
+        }
+
+        // True if the cell is free for a new entity: buildable on the board and not reserved or joined.
+        bool IsAvailable(CellPosition cellPosition) const
+        {
+            return IsFree(GetIndex(cellPosition));
+        }
+
+        // Appends the shortest conveyor path that carries a product dropped on startCellPosition into
+        // the collection center. Returns false if no such path exists.
+        bool AppendPath(CellPosition startCellPosition, std::queue<PlayerAction> &actions) const
+        {
+            if (!IsWithinBoard(startCellPosition) || !IsReachable(startCellPosition))
+                return false;
+
+            // Built aside and appended whole, so a failed path leaves actions as they were.
+            std::queue<PlayerAction> path;
+            CellPosition cellPosition = startCellPosition;
+
+            while (distances_[GetIndex(cellPosition)] != 0)
+            {
+                Direction direction;
+                if (!GetNextHop(cellPosition, direction))
+                    return false;
+
+                CellPosition next = GetNeighborCellPosition(cellPosition, direction);
+                if (distances_[GetIndex(next)] >= distances_[GetIndex(cellPosition)])
+                    return false;
+
+                path.push({GetConveyorActionType(direction), cellPosition});
+                cellPosition = next;
+            }
+
+            for (; !path.empty(); path.pop())
+            {
+                actions.push(path.front());
+            }
+            return true;
+        }
+
+        // Returns a mining machine on miningCellPosition followed by the shortest conveyor path into
+        // the collection center, or an empty queue if the site cannot be used.
+        std::queue<PlayerAction> PlanRoute(const IGameInfo &info, CellPosition miningCellPosition) const
+        {
+            std::queue<PlayerAction> actions;
+
+            if (!IsWithinBoard(miningCellPosition) || !IsFree(GetIndex(miningCellPosition)))
+                return actions;
+
+            if (dynamic_cast<const NumberCell *>(info.GetLayeredCell(miningCellPosition).GetBackground().get()) == nullptr)
+                return actions;
+
+            Direction direction;
+            if (!GetNextHop(miningCellPosition, direction))
+                return actions;
+
+            actions.push({GetMiningMachineActionType(direction), miningCellPosition});
+            if (!AppendPath(GetNeighborCellPosition(miningCellPosition, direction), actions))
+                return {};
+            return actions;
+        }
+
+        static PlayerActionType GetMiningMachineActionType(Direction direction)
+        {
+            switch (direction)
+            {
+            case Direction::kTop:
+                return PlayerActionType::BuildTopOutMiningMachine;
+            case Direction::kRight:
+                return PlayerActionType::BuildRightOutMiningMachine;
+            case Direction::kBottom:
+                return PlayerActionType::BuildBottomOutMiningMachine;
+            case Direction::kLeft:
+                return PlayerActionType::BuildLeftOutMiningMachine;
+            }
+            assert(false);
+            return PlayerActionType::None;
+        }
+
+        static PlayerActionType GetConveyorActionType(Direction direction)
+        {
+            switch (direction)
+            {
+            case Direction::kTop:
+                return PlayerActionType::BuildBottomToTopConveyor;
+            case Direction::kRight:
+                return PlayerActionType::BuildLeftToRightConveyor;
+            case Direction::kBottom:
+                return PlayerActionType::BuildTopToBottomConveyor;
+            case Direction::kLeft:
+                return PlayerActionType::BuildRightToLeftConveyor;
+            }
+            assert(false);
+            return PlayerActionType::None;
+        }
+
+    private:
+        enum class CellKind
+        {
+            kBlocked,
+            kFree,
+            kSink
+        };
+
+        static constexpr int kCellCount = GameManagerConfig::kBoardWidth * GameManagerConfig::kBoardHeight;
+
+        static int GetIndex(CellPosition cellPosition)
+        {
+            return cellPosition.row * GameManagerConfig::kBoardWidth + cellPosition.col;
+        }
+
+        static CellPosition GetCellPosition(int index)
+        {
+            return {index / GameManagerConfig::kBoardWidth, index % GameManagerConfig::kBoardWidth};
+        }
+
+        static CellKind ReadCellKind(const IGameInfo &info, CellPosition cellPosition)
+        {
+            const LayeredCell &layeredCell = info.GetLayeredCell(cellPosition);
+
+            if (dynamic_cast<const CollectionCenterCell *>(layeredCell.GetForeground().get()))
+                return CellKind::kSink;
+
+            return layeredCell.CanBuild() ? CellKind::kFree : CellKind::kBlocked;
+        }
+
+        bool IsFree(int index) const
+        {
+            return kinds_[index] == CellKind::kFree && !reserved_[index] && !joined_[index];
+        }
+
+        std::size_t GetNeighbors(int index, std::array<int, 4> &neighbors) const
+        {
+            std::size_t count = 0;
+            CellPosition cellPosition = GetCellPosition(index);
+            for (int k = 0; k < 4; ++k)
+            {
+                CellPosition neighborCellPosition = GetNeighborCellPosition(cellPosition, static_cast<Direction>(k));
+                if (IsWithinBoard(neighborCellPosition))
+                {
+                    neighbors[count++] = GetIndex(neighborCellPosition);
+                }
+            }
+            return count;
+        }
+
+        int GetBestNeighborDistance(int index) const
+        {
+            std::array<int, 4> neighbors;
+            std::size_t count = GetNeighbors(index, neighbors);
+
+            int best = kUnreachable;
+            for (std::size_t k = 0; k < count; ++k)
+            {
+                best = std::min(best, distances_[neighbors[k]]);
+            }
+            return best;
+        }
+
+        bool GetNextHop(CellPosition cellPosition, Direction &direction) const
+        {
+            int best = kUnreachable;
+            for (int k = 0; k < 4; ++k)
+            {
+                CellPosition neighborCellPosition = GetNeighborCellPosition(cellPosition, static_cast<Direction>(k));
+                if (IsWithinBoard(neighborCellPosition) && distances_[GetIndex(neighborCellPosition)] < best)
+                {
+                    best = distances_[GetIndex(neighborCellPosition)];
+                    direction = static_cast<Direction>(k);
+                }
+            }
+            return best != kUnreachable;
+        }
+
+        bool IsSink(int index) const
+        {
+            return kinds_[index] == CellKind::kSink || joined_[index];
+        }
+
+        void Refresh(int index)
+        {
+            if (IsSink(index))
+            {
+                if (distances_[index] != 0)
+                {
+                    distances_[index] = 0;
+                    std::queue<int> frontier;
+                    frontier.push(index);
+                    Propagate(frontier);
+                }
+            }
+            else if (IsFree(index) && distances_[index] == kUnreachable)
+            {
+                int best = GetBestNeighborDistance(index);
+                if (best != kUnreachable)
+                {
+                    distances_[index] = best + 1;
+                    std::queue<int> frontier;
+                    frontier.push(index);
+                    Propagate(frontier);
+                }
+            }
+            else
+            {
+                Invalidate(index);
+            }
+        }
+
+        // Breadth-first relaxation of distance decreases starting from the given cells.
+        void Propagate(std::queue<int> &frontier)
+        {
+            while (!frontier.empty())
+            {
+                int index = frontier.front();
+                frontier.pop();
+
+                std::array<int, 4> neighbors;
+                std::size_t count = GetNeighbors(index, neighbors);
+                for (std::size_t k = 0; k < count; ++k)
+                {
+                    if (IsFree(neighbors[k]) && distances_[neighbors[k]] > distances_[index] + 1)
+                    {
+                        distances_[neighbors[k]] = distances_[index] + 1;
+                        frontier.push(neighbors[k]);
+                    }
+                }
+            }
+        }
+
+        // Removes a cell from the field: every cell that loses all of its shortest-path parents is
+        // invalidated in order of its old distance, then the invalidated region is re-filled from
+        // its intact boundary.
+        void Invalidate(int index)
+        {
+            if (distances_[index] == kUnreachable)
+                return;
+
+            using Entry = std::pair<int, int>;
+            std::priority_queue<Entry, std::vector<Entry>, std::greater<Entry>> pending;
+            std::vector<int> invalidated;
+            std::array<int, 4> neighbors;
+            std::size_t count = GetNeighbors(index, neighbors);
+
+            distances_[index] = kUnreachable;
+            invalidated.push_back(index);
+            for (std::size_t k = 0; k < count; ++k)
+            {
+                if (IsFree(neighbors[k]) && distances_[neighbors[k]] != kUnreachable)
+                {
+                    pending.push({distances_[neighbors[k]], neighbors[k]});
+                }
+            }
+
+            while (!pending.empty())
+            {
+                auto [distance, current] = pending.top();
+                pending.pop();
+
+                if (distances_[current] != distance)
+                    continue;
+
+                if (GetBestNeighborDistance(current) == distance - 1)
+                    continue;
+
+                distances_[current] = kUnreachable;
+                invalidated.push_back(current);
+                count = GetNeighbors(current, neighbors);
+                for (std::size_t k = 0; k < count; ++k)
+                {
+                    if (IsFree(neighbors[k]) && distances_[neighbors[k]] == distance + 1)
+                    {
+                        pending.push({distances_[neighbors[k]], neighbors[k]});
+                    }
+                }
+            }
+
+            for (int current : invalidated)
+            {
+                if (!IsFree(current))
+                    continue;
+
+                int best = GetBestNeighborDistance(current);
+                if (best != kUnreachable)
+                {
+                    pending.push({best + 1, current});
+                }
+            }
+
+            while (!pending.empty())
+            {
+                auto [distance, current] = pending.top();
+                pending.pop();
+
+                if (distances_[current] <= distance)
+                    continue;
+
+                distances_[current] = distance;
+                count = GetNeighbors(current, neighbors);
+                for (std::size_t k = 0; k < count; ++k)
+                {
+                    if (IsFree(neighbors[k]) && distances_[neighbors[k]] > distance + 1)
+                    {
+                        pending.push({distance + 1, neighbors[k]});
+                    }
+                }
+            }
+        }
+
+        std::vector<CellKind> kinds_;
+        std::vector<bool> reserved_;
+        std::vector<bool> joined_;
+        std::vector<int> distances_;
+    };
+}
+#endif
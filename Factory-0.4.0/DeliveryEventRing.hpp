@@ -0,0 +1,73 @@
+#ifndef DELIVERY_EVENT_RING_HPP
+#define DELIVERY_EVENT_RING_HPP
+#include <array>
+#include <atomic>
+#include <cstddef>
+#include "PDOGS.cpp"
+
+namespace Feis
+{
+    // Fixed ring of delivery events between the thread updating a game and one reader, say a
+    // dashboard or a logger. Neither side locks or allocates: each owns one index and only reads the
+    // other's. When the reader falls behind by kCapacity events, new events are dropped and counted
+    // rather than slowing the game down.
+    template <std::size_t kCapacity>
+    class DeliveryEventRing : public IDeliveryEventSink
+    {
+        static_assert(kCapacity > 0 && (kCapacity & (kCapacity - 1)) == 0, "kCapacity must be a power of two");
+
+    public:
+        // Writer side.
+        void OnDelivery(const DeliveryEvent &event) override
+        {
+            std::size_t head = head_.load(std::memory_order_relaxed);
+
+            if (head - cachedTail_ == kCapacity)
+            {
+                cachedTail_ = tail_.load(std::memory_order_acquire);
+                if (head - cachedTail_ == kCapacity)
+                {
+                    droppedCount_.fetch_add(1, std::memory_order_relaxed);
+                    return;
+                }
+            }
+
+            events_[head & (kCapacity - 1)] = event;
+            head_.store(head + 1, std::memory_order_release);
+        }
+
+        // Reader side; false if no event is waiting.
+        bool TryPop(DeliveryEvent &event)
+        {
+            std::size_t tail = tail_.load(std::memory_order_relaxed);
+
+            if (tail == cachedHead_)
+            {
+                cachedHead_ = head_.load(std::memory_order_acquire);
+                if (tail == cachedHead_)
+                    return false;
+            }
+
+            event = events_[tail & (kCapacity - 1)];
+            tail_.store(tail + 1, std::memory_order_release);
+            return true;
+        }
+
+        // Events lost to a full ring so far; readable from either side.
+        std::size_t GetDroppedCount() const
+        {
+            return droppedCount_.load(std::memory_order_relaxed);
+        }
+
+    private:
+        // The indices only grow; each side caches the other's so that it rarely touches the other
+        // side's cache line.
+        alignas(64) std::atomic<std::size_t> head_{0};
+        std::size_t cachedTail_ = 0;
+        alignas(64) std::atomic<std::size_t> tail_{0};
+        std::size_t cachedHead_ = 0;
+        alignas(64) std::atomic<std::size_t> droppedCount_{0};
+        std::array<DeliveryEvent, kCapacity> events_;
+    };
+}
+#endif
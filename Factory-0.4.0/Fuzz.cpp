@@ -0,0 +1,481 @@
+#define USE_HEADLESS
+#include <algorithm>
+#include <iostream>
+#include <random>
+#include <string>
+#include <vector>
+
+#include "PDOGS.cpp"
+#include "ConveyorRouter.hpp"
+#include "CombinerPlanner.hpp"
+#include "ScriptedGamePlayer.hpp"
+#include "BatchedGameManager.hpp"
+#include "BatchedEngineRegistry.hpp"
+#include "ReferenceGameManager.hpp"
+#include "ThreadPool.hpp"
+#include "Replay.hpp"
+
+using namespace Feis;
+
+// A random game: GameManager and an alternative engine play it and must agree after every tick. On
+// other shapes than the judged one, the batched engine plays it against ReferenceGameManager.
+struct FuzzCase
+{
+    int commonDividor;
+    unsigned int seed;
+    std::vector<PlayerAction> actions;
+    EngineShape shape;
+};
+
+enum class Engine
+{
+    kStriped,
+    kBatched,
+    kReference,
+    kShapes,
+    kUndo,
+};
+
+constexpr Engine kEngines[] = {Engine::kStriped, Engine::kBatched, Engine::kReference, Engine::kShapes, Engine::kUndo};
+
+constexpr std::size_t kLanes = BatchedEngineRegistry::kLanes;
+
+constexpr EngineShape kJudgedShape{GameManagerConfig::kBoardWidth, GameManagerConfig::kBoardHeight, GameManagerConfig::kConveyorBufferSize};
+
+const char *GetEngineName(Engine engine)
+{
+    switch (engine)
+    {
+    case Engine::kStriped:
+        return "striped";
+    case Engine::kBatched:
+        return "batched";
+    case Engine::kReference:
+        return "reference";
+    case Engine::kShapes:
+        return "shapes";
+    case Engine::kUndo:
+        return "undo";
+    }
+    return "";
+}
+
+// Engines that play kLanes cases together, so that a case may only fail next to its neighbours.
+bool IsBatched(Engine engine)
+{
+    return engine == Engine::kBatched || engine == Engine::kShapes;
+}
+
+std::queue<PlayerAction> ToQueue(const std::vector<PlayerAction> &actions)
+{
+    std::queue<PlayerAction> queue;
+    for (const PlayerAction &action : actions)
+    {
+        queue.push(action);
+    }
+    return queue;
+}
+
+// Random actions land near the collection center, where entities link up into working chains, and
+// now and then anywhere. Half of the cases on the judged shape mutate a greedy plan instead, which
+// gets long chains running early; the planner needs a GameManager, so other shapes only get random
+// actions.
+FuzzCase MakeCase(std::mt19937 &random, EngineShape shape = kJudgedShape)
+{
+    FuzzCase fuzzCase{1 + static_cast<int>(random() % 5), static_cast<unsigned int>(random()), {}, shape};
+    std::size_t actionCount = GameManagerConfig::kEndTime / 3;
+    int collectionCenterTop = shape.height / 2 - static_cast<int>(GameManagerConfig::kGoalSize / 2);
+    int collectionCenterLeft = shape.width / 2 - static_cast<int>(GameManagerConfig::kGoalSize / 2);
+
+    auto randomAction = [&]()
+    {
+        PlayerAction action;
+        action.type = static_cast<PlayerActionType>(random() % (static_cast<int>(PlayerActionType::Clear) + 1));
+        if (random() % 4 == 0)
+        {
+            action.cellPosition = {static_cast<int>(random() % shape.height), static_cast<int>(random() % shape.width)};
+        }
+        else
+        {
+            action.cellPosition = {collectionCenterTop - 6 + static_cast<int>(random() % 16),
+                                   collectionCenterLeft - 6 + static_cast<int>(random() % 16)};
+        }
+        return action;
+    };
+
+    if (random() % 2 == 0 && shape == kJudgedShape)
+    {
+        ScriptedGamePlayer player;
+        GameManager game(&player, fuzzCase.commonDividor, fuzzCase.seed);
+        ConveyorRouter router(game);
+        CombinerPlanner planner(game);
+        std::queue<PlayerAction> plan = planner.Plan(game, router, actionCount);
+
+        while (!plan.empty())
+        {
+            fuzzCase.actions.push_back(random() % 8 == 0 ? randomAction() : plan.front());
+            plan.pop();
+        }
+    }
+
+    while (fuzzCase.actions.size() < actionCount)
+    {
+        fuzzCase.actions.push_back(randomAction());
+    }
+    return fuzzCase;
+}
+
+// Plays a case's actions by elapsed time rather than one per call, so that a game rolled back with
+// Undo issues the same actions again when it replays the ticks.
+class TimedGamePlayer : public IGamePlayer
+{
+public:
+    TimedGamePlayer(const std::vector<PlayerAction> &actions) : actions_(actions) {}
+
+    PlayerAction GetNextAction(const IGameInfo &info) override
+    {
+        std::size_t index = info.GetElapsedTime() / 3 - 1;
+        if (index >= actions_.size())
+        {
+            return {PlayerActionType::None, {0, 0}};
+        }
+        return actions_[index];
+    }
+
+private:
+    const std::vector<PlayerAction> &actions_;
+};
+
+// Plays each case with the undo journal on and a limit that makes it trim, now and then undoes a
+// random number of the ticks it still holds, and checks every state it reaches against the hash
+// first recorded for that tick.
+std::vector<int> FindUndoDivergences(const std::vector<FuzzCase> &cases)
+{
+    std::vector<int> divergences(cases.size(), 0);
+
+    for (std::size_t k = 0; k < cases.size(); ++k)
+    {
+        TimedGamePlayer player(cases[k].actions);
+        GameManager game(&player, cases[k].commonDividor, cases[k].seed);
+        std::size_t undoLimit = 100 + cases[k].seed % 900;
+        game.EnableUndo(true);
+        game.SetUndoLimit(undoLimit);
+
+        std::mt19937 random(cases[k].seed);
+        std::vector<std::size_t> hashes{game.GetStateHash()};
+        while (!game.IsGameOver() && divergences[k] == 0)
+        {
+            game.Update();
+            int tick = game.GetElapsedTime();
+            if (tick == static_cast<int>(hashes.size()))
+            {
+                hashes.push_back(game.GetStateHash());
+            }
+            else if (game.GetStateHash() != hashes[tick] || game.GetUndoDepth() > undoLimit)
+            {
+                divergences[k] = tick;
+            }
+
+            // Rollbacks stay short enough on average for the game to move forward; now and then
+            // one goes back as far as the journal reaches.
+            std::size_t depth = game.GetUndoDepth();
+            if (divergences[k] == 0 && random() % 100 == 0 && depth > 0)
+            {
+                std::size_t ticks = random() % 20 == 0 ? depth : 1 + random() % std::min<std::size_t>(depth, 100);
+                if (!game.Undo(ticks) || game.GetElapsedTime() != tick - static_cast<int>(ticks) ||
+                    game.GetStateHash() != hashes[game.GetElapsedTime()])
+                {
+                    divergences[k] = tick;
+                }
+            }
+        }
+    }
+    return divergences;
+}
+
+// Plays the cases kLanes at a time on the batched engine of their shape and on ReferenceGameManager
+// side by side, like FindDivergences.
+std::vector<int> FindShapeDivergences(const std::vector<FuzzCase> &cases)
+{
+    std::vector<int> divergences(cases.size(), 0);
+    const BatchedEngineRegistry::Entry *entry = BatchedEngineRegistry::Find(cases.front().shape);
+
+    for (std::size_t first = 0; first < cases.size(); first += kLanes)
+    {
+        std::vector<BatchedLaneConfig> lanes;
+        std::vector<std::unique_ptr<IReferenceGame>> references;
+        for (std::size_t lane = 0; lane < kLanes; ++lane)
+        {
+            const FuzzCase &fuzzCase = cases[first + lane];
+            lanes.push_back({fuzzCase.commonDividor, fuzzCase.seed, ToQueue(fuzzCase.actions)});
+            references.push_back(entry->createReference(lanes.back()));
+        }
+
+        std::unique_ptr<IBatchedEngine> batch = entry->create(lanes);
+        std::size_t liveLanes = kLanes;
+        while (!batch->IsGameOver() && liveLanes > 0)
+        {
+            batch->Update();
+            for (std::size_t lane = 0; lane < kLanes; ++lane)
+            {
+                std::size_t k = first + lane;
+                if (divergences[k] != 0)
+                    continue;
+
+                references[lane]->Update();
+                if (references[lane]->GetStateHash() != batch->GetStateHash(lane))
+                {
+                    divergences[k] = batch->GetElapsedTime();
+                    --liveLanes;
+                }
+            }
+        }
+    }
+    return divergences;
+}
+
+// Plays the cases on GameManager and on the engine side by side and returns, per case, the first
+// tick after which the state hashes differ, or 0. Batched cases go kLanes to an engine.
+std::vector<int> FindDivergences(Engine engine, const std::vector<FuzzCase> &cases, ThreadPool &pool)
+{
+    if (engine == Engine::kShapes)
+        return FindShapeDivergences(cases);
+    if (engine == Engine::kUndo)
+        return FindUndoDivergences(cases);
+
+    std::vector<int> divergences(cases.size(), 0);
+
+    std::vector<std::unique_ptr<ScriptedGamePlayer>> players;
+    std::vector<std::unique_ptr<GameManager>> games;
+    for (const FuzzCase &fuzzCase : cases)
+    {
+        players.push_back(std::make_unique<ScriptedGamePlayer>(ToQueue(fuzzCase.actions)));
+        games.push_back(std::make_unique<GameManager>(players.back().get(), fuzzCase.commonDividor, fuzzCase.seed));
+    }
+
+    if (engine == Engine::kReference)
+    {
+        for (std::size_t k = 0; k < cases.size(); ++k)
+        {
+            auto reference = std::make_unique<ReferenceGameManager<>>(cases[k].commonDividor, cases[k].seed, ToQueue(cases[k].actions));
+            while (!reference->IsGameOver())
+            {
+                games[k]->Update();
+                reference->Update();
+                if (games[k]->GetStateHash() != reference->GetStateHash())
+                {
+                    divergences[k] = reference->GetElapsedTime();
+                    break;
+                }
+            }
+        }
+        return divergences;
+    }
+
+    if (engine == Engine::kStriped)
+    {
+        auto parallelFor = [&pool](std::size_t count, const std::function<void(std::size_t)> &task)
+        {
+            for (std::size_t k = 0; k < count; ++k)
+            {
+                pool.Submit([&task, k]
+                            { task(k); });
+            }
+            pool.Wait();
+        };
+
+        for (std::size_t k = 0; k < cases.size(); ++k)
+        {
+            ScriptedGamePlayer player(ToQueue(cases[k].actions));
+            GameManager striped(&player, cases[k].commonDividor, cases[k].seed);
+            striped.EnableParallelUpdate(parallelFor, 2 + cases[k].seed % 7);
+
+            while (!striped.IsGameOver())
+            {
+                games[k]->Update();
+                striped.Update();
+                if (games[k]->GetStateHash() != striped.GetStateHash())
+                {
+                    divergences[k] = striped.GetElapsedTime();
+                    break;
+                }
+            }
+        }
+        return divergences;
+    }
+
+    for (std::size_t first = 0; first < cases.size(); first += kLanes)
+    {
+        std::array<BatchedGameManager<kLanes>::LaneConfig, kLanes> lanes;
+        for (std::size_t lane = 0; lane < kLanes; ++lane)
+        {
+            const FuzzCase &fuzzCase = cases[first + lane];
+            lanes[lane] = {fuzzCase.commonDividor, fuzzCase.seed, ToQueue(fuzzCase.actions)};
+        }
+
+        BatchedGameManager<kLanes> batch(std::move(lanes));
+        std::size_t liveLanes = kLanes;
+        while (!batch.IsGameOver() && liveLanes > 0)
+        {
+            batch.Update();
+            for (std::size_t lane = 0; lane < kLanes; ++lane)
+            {
+                std::size_t k = first + lane;
+                if (divergences[k] != 0)
+                    continue;
+
+                games[k]->Update();
+                if (games[k]->GetStateHash() != batch.GetStateHash(lane))
+                {
+                    divergences[k] = batch.GetElapsedTime();
+                    --liveLanes;
+                }
+            }
+        }
+    }
+    return divergences;
+}
+
+// Delta debugging over the actions of one failing case: drops ever smaller chunks as long as the
+// case still diverges. A batched lane keeps its neighbours, since it may only fail next to them;
+// other cases are replayed alone.
+void Shrink(Engine engine, std::vector<FuzzCase> &cases, std::size_t index, ThreadPool &pool)
+{
+    std::vector<FuzzCase> context = IsBatched(engine) ? cases : std::vector<FuzzCase>{cases[index]};
+    std::size_t position = IsBatched(engine) ? index : 0;
+    std::vector<PlayerAction> &actions = context[position].actions;
+
+    auto diverges = [&](const std::vector<PlayerAction> &candidate)
+    {
+        std::vector<PlayerAction> original = std::move(actions);
+        actions = candidate;
+        bool failed = FindDivergences(engine, context, pool)[position] != 0;
+        actions = std::move(original);
+        return failed;
+    };
+
+    // Actions are applied every third tick, so those after the divergence cannot matter.
+    int tick = FindDivergences(engine, context, pool)[position];
+    actions.resize(std::min<std::size_t>(actions.size(), tick / 3));
+
+    std::size_t chunkCount = 2;
+    while (actions.size() >= 2)
+    {
+        std::size_t chunkSize = (actions.size() + chunkCount - 1) / chunkCount;
+        bool reduced = false;
+
+        for (std::size_t begin = 0; begin < actions.size(); begin += chunkSize)
+        {
+            std::vector<PlayerAction> candidate(actions.begin(), actions.begin() + begin);
+            candidate.insert(candidate.end(), actions.begin() + std::min(begin + chunkSize, actions.size()), actions.end());
+
+            if (diverges(candidate))
+            {
+                actions = std::move(candidate);
+                chunkCount = std::max<std::size_t>(chunkCount - 1, 2);
+                reduced = true;
+                break;
+            }
+        }
+
+        if (!reduced)
+        {
+            if (chunkSize == 1)
+                break;
+            chunkCount = std::min(chunkCount * 2, actions.size());
+        }
+    }
+
+    cases[index].actions = actions;
+}
+
+// Runs random cases against GameManager, and on the other shapes against ReferenceGameManager,
+// until one diverges, then shrinks its actions and saves them as a replay.
+int main(int argc, char **argv)
+{
+    if (argc < 2)
+    {
+        std::cout << "Usage: Fuzz <cases> [first seed] [striped|batched|reference|shapes|undo|all]" << std::endl;
+        return 1;
+    }
+
+    std::size_t caseCount = (std::stoul(argv[1]) + kLanes - 1) / kLanes * kLanes;
+    unsigned int firstSeed = argc > 2 ? static_cast<unsigned int>(std::stoul(argv[2])) : 1;
+    std::string engineName = argc > 3 ? argv[3] : "all";
+
+    std::vector<Engine> engines;
+    for (Engine engine : kEngines)
+    {
+        if (engineName == "all" || engineName == GetEngineName(engine))
+        {
+            engines.push_back(engine);
+        }
+    }
+
+    ThreadPool pool;
+
+    for (std::size_t first = 0; first < caseCount; first += kLanes)
+    {
+        std::mt19937 random(firstSeed + static_cast<unsigned int>(first));
+        std::vector<FuzzCase> cases;
+        for (std::size_t lane = 0; lane < kLanes; ++lane)
+        {
+            cases.push_back(MakeCase(random));
+        }
+
+        // The judged shape is left to the batched engine, which GameManager checks directly.
+        std::vector<std::pair<Engine, std::vector<FuzzCase>>> runs;
+        for (Engine engine : engines)
+        {
+            if (engine != Engine::kShapes)
+            {
+                runs.push_back({engine, cases});
+                continue;
+            }
+
+            for (const BatchedEngineRegistry::Entry &entry : BatchedEngineRegistry::GetEntries())
+            {
+                if (entry.shape == kJudgedShape)
+                    continue;
+
+                std::vector<FuzzCase> shapeCases;
+                for (std::size_t lane = 0; lane < kLanes; ++lane)
+                {
+                    shapeCases.push_back(MakeCase(random, entry.shape));
+                }
+                runs.push_back({engine, std::move(shapeCases)});
+            }
+        }
+
+        for (auto &[engine, runCases] : runs)
+        {
+            std::vector<int> divergences = FindDivergences(engine, runCases, pool);
+
+            for (std::size_t k = 0; k < runCases.size(); ++k)
+            {
+                if (divergences[k] == 0)
+                    continue;
+
+                const FuzzCase &fuzzCase = runCases[k];
+                std::string shapeName = std::to_string(fuzzCase.shape.width) + "x" + std::to_string(fuzzCase.shape.height) +
+                                        "x" + std::to_string(fuzzCase.shape.bufferSize);
+                std::cout << GetEngineName(engine) << " diverges after tick " << divergences[k] << " on " << shapeName
+                          << ", divisor " << fuzzCase.commonDividor << ", seed " << fuzzCase.seed
+                          << "; shrinking " << fuzzCase.actions.size() << " actions" << std::endl;
+
+                Shrink(engine, runCases, k, pool);
+
+                std::string filename = std::string("fuzz-") + GetEngineName(engine) + "-" +
+                                       (engine == Engine::kShapes ? shapeName + "-" : "") +
+                                       std::to_string(fuzzCase.commonDividor) + "-" + std::to_string(fuzzCase.seed) + ".txt";
+                SaveReplay(ToQueue(fuzzCase.actions), filename);
+                std::cout << "Diverges after tick " << FindDivergences(engine, runCases, pool)[k] << " with "
+                          << fuzzCase.actions.size() << " actions, saved to " << filename << std::endl;
+                return 1;
+            }
+        }
+
+        std::cout << first + kLanes << "/" << caseCount << " cases agree" << std::endl;
+    }
+    return 0;
+}
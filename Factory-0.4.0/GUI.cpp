@@ -6,25 +6,27 @@
 #include "PDOGS.cpp"
 
 #include "GameRenderer.hpp"
+#include "Replay.hpp"
+#include "SimulationThread.hpp"
 
 using namespace Feis;
 
 struct GameRendererConfig
 {
-    static constexpr int kFPS = 9000;
+    static constexpr int kFPS = 60;
+    static constexpr int kTicksPerSecond = 9000;
     static constexpr int kCellSize = 20;
     static constexpr int kBoardLeft = 20;
     static constexpr int kBoardTop = 60;
     static constexpr int kBorderSize = 1;
+    static constexpr int kRewindInterval = 300;
+    static constexpr std::size_t kRewindCapacity = 31;
+    static constexpr int kRewindStep = 30;
 };
 
-CellPosition GetMouseCellPosition(const sf::RenderWindow &window)
+CellPosition GetMouseCellPosition(const sf::RenderWindow &window, const GameRenderer<GameRendererConfig> &gameRenderer)
 {
-    const sf::Vector2i mousePosition = sf::Mouse::getPosition(window);
-    const sf::Vector2i relatedMousePosition =
-        mousePosition - sf::Vector2i(GameRendererConfig::kBoardLeft, GameRendererConfig::kBoardTop);
-    return {relatedMousePosition.y / GameRendererConfig::kCellSize,
-            relatedMousePosition.x / GameRendererConfig::kCellSize};
+    return gameRenderer.GetCellPosition(sf::Mouse::getPosition(window));
 }
 
 class GamePlayer : public Feis::IGamePlayer
@@ -1826,17 +1828,6 @@ private:
     }
 };
 
-void Save(std::queue<PlayerAction> playerActionHistory, const std::string &filename)
-{
-    std::ofstream outFile(filename);
-    while (!playerActionHistory.empty())
-    {
-        const PlayerAction &playerAction = playerActionHistory.front();
-        outFile << playerAction.cellPosition.row << " " << playerAction.cellPosition.col << " " << static_cast<int>(playerAction.type) << std::endl;
-        playerActionHistory.pop();
-    }
-}
-
 int main(int, char **)
 {
     sf::VideoMode mode = sf::VideoMode(1280, 1024);
@@ -1847,7 +1838,15 @@ int main(int, char **)
 
     GamePlayer player;
 
-    GameManager gameManager(&player, 4, 35);
+    RewindBuffer rewindBuffer(GameRendererConfig::kRewindInterval, GameRendererConfig::kRewindCapacity);
+
+    RecordingGamePlayer recordingPlayer(&player, &rewindBuffer);
+
+    GameManager gameManager(&recordingPlayer, 4, 35);
+
+    SimulationThread simulation(&gameManager, GameRendererConfig::kTicksPerSecond);
+
+    simulation.SetRewindBuffer(&rewindBuffer);
 
     const std::map<sf::Keyboard::Key, PlayerActionType> playerActionKeyboardMap = {
         {sf::Keyboard::J, PlayerActionType::BuildLeftOutMiningMachine},
@@ -1871,6 +1870,27 @@ int main(int, char **)
 
     std::queue<PlayerAction> playerActionHistory;
 
+    // Space pauses and resumes. F5, F6 and F7 run 1, 10 and 100 ticks per displayed frame, F8 as
+    // many as possible and F9 as many as fit in each frame besides rendering.
+    const std::map<sf::Keyboard::Key, double> speedKeyboardMap = {
+        {sf::Keyboard::F5, GameRendererConfig::kFPS},
+        {sf::Keyboard::F6, GameRendererConfig::kFPS * 10},
+        {sf::Keyboard::F7, GameRendererConfig::kFPS * 100},
+        {sf::Keyboard::F8, SimulationThread::kUnlimited},
+    };
+
+    // Left/Right step the view back and forth by kRewindStep ticks, PageUp/PageDown by one rewind
+    // interval, and End returns to the live game.
+    std::unique_ptr<GameManager> rewindGame;
+
+    // The mouse wheel zooms around the cursor, dragging with the right button pans and Home
+    // resets the view.
+    constexpr float kWheelZoomFactor = 1.25f;
+    bool panning = false;
+    sf::Vector2i panOrigin;
+
+    simulation.Start();
+
     while (window.isOpen())
     {
         sf::Event event;
@@ -1878,7 +1898,7 @@ int main(int, char **)
         {
             /*if (event.type == sf::Event::MouseButtonReleased)
             {
-                CellPosition mouseCellPosition = GetMouseCellPosition(window);
+                CellPosition mouseCellPosition = GetMouseCellPosition(window, gameRenderer);
 
                 if (IsWithinBoard(mouseCellPosition))
                 {
@@ -1899,19 +1919,112 @@ int main(int, char **)
                 }
                 else if (event.key.code == sf::Keyboard::F4)
                 {
-                    Save(playerActionHistory, "gameplay.txt");
+                    SaveReplay(playerActionHistory, "gameplay.txt");
                 }
             }*/
+            if (event.type == sf::Event::MouseWheelScrolled &&
+                event.mouseWheelScroll.wheel == sf::Mouse::VerticalWheel)
+            {
+                gameRenderer.Zoom(
+                    std::pow(kWheelZoomFactor, -event.mouseWheelScroll.delta),
+                    sf::Vector2i(event.mouseWheelScroll.x, event.mouseWheelScroll.y));
+            }
+            else if (event.type == sf::Event::MouseButtonPressed && event.mouseButton.button == sf::Mouse::Right)
+            {
+                panning = true;
+                panOrigin = sf::Vector2i(event.mouseButton.x, event.mouseButton.y);
+            }
+            else if (event.type == sf::Event::MouseButtonReleased && event.mouseButton.button == sf::Mouse::Right)
+            {
+                panning = false;
+            }
+            else if (event.type == sf::Event::MouseMoved && panning)
+            {
+                sf::Vector2i position(event.mouseMove.x, event.mouseMove.y);
+                gameRenderer.Pan(position - panOrigin);
+                panOrigin = position;
+            }
+
+            if (event.type == sf::Event::KeyPressed)
+            {
+                if (event.key.code == sf::Keyboard::Home)
+                {
+                    gameRenderer.ResetView();
+                }
+                else if (event.key.code == sf::Keyboard::Space)
+                {
+                    simulation.SetPaused(!simulation.IsPaused());
+                }
+                else if (speedKeyboardMap.count(event.key.code))
+                {
+                    simulation.SetTicksPerSecond(speedKeyboardMap.at(event.key.code));
+                }
+                else if (event.key.code == sf::Keyboard::F9)
+                {
+                    simulation.SetAdaptive(GameRendererConfig::kFPS);
+                }
+
+                int step = 0;
+                switch (event.key.code)
+                {
+                case sf::Keyboard::Left:
+                    step = -GameRendererConfig::kRewindStep;
+                    break;
+                case sf::Keyboard::Right:
+                    step = GameRendererConfig::kRewindStep;
+                    break;
+                case sf::Keyboard::PageUp:
+                    step = -GameRendererConfig::kRewindInterval;
+                    break;
+                case sf::Keyboard::PageDown:
+                    step = GameRendererConfig::kRewindInterval;
+                    break;
+                case sf::Keyboard::End:
+                    rewindGame.reset();
+                    gameRenderer.Invalidate();
+                    window.setTitle("DSAP Final Project");
+                    break;
+                default:
+                    break;
+                }
+
+                if (step != 0)
+                {
+                    int newestTick = rewindBuffer.GetNewestTick();
+                    int tick = (rewindGame ? rewindGame->GetElapsedTime() : newestTick) + step;
+                    tick = std::max(tick, rewindBuffer.GetOldestTick());
+
+                    if (tick >= newestTick)
+                    {
+                        rewindGame.reset();
+                        window.setTitle("DSAP Final Project");
+                    }
+                    else
+                    {
+                        rewindGame = rewindBuffer.Rebuild(tick);
+                        window.setTitle("DSAP Final Project - rewound to tick " + std::to_string(tick));
+                    }
+                    gameRenderer.Invalidate();
+                }
+            }
+
             if (event.type == sf::Event::Closed)
             {
                 window.close();
             }
         }
 
-        gameManager.Update();
-
-        gameRenderer.Render(gameManager);
+        if (rewindGame)
+        {
+            gameRenderer.Render(*rewindGame);
+        }
+        else
+        {
+            gameRenderer.Render(*simulation.GetSnapshot());
+        }
     }
+
+    simulation.Stop();
 }
 // void Test1A() { Test(1, 20); }
 // void Test1B() { Test(1, 0 /* HIDDEN */); }
@@ -1,62 +1,313 @@
+#include <algorithm>
+#include <cmath>
+#include <vector>
 #include "PDOGS.cpp"
+#include "ThreadPool.hpp"
 #include "Drawer.hpp"
 #include "LayeredCellRenderer.hpp"
+#include "BoardSummary.hpp"
 
 template <typename TGameRendererConfig>
-class GameRenderer 
+class GameRenderer
 {
 public:
     using GameManagerConfig = Feis::GameManagerConfig;
+    using CellPosition = Feis::CellPosition;
 
-    GameRenderer(sf::RenderWindow *window) : renderer_(window)
+    // Zoom is the number of world pixels per screen pixel, so 1 shows the board as it always was.
+    static constexpr float kMinZoom = 0.25f;
+    static constexpr float kMaxZoom = 16.0f;
+    // Below this many screen pixels per cell, the board is drawn from BoardSummary instead.
+    static constexpr float kSummaryCellPixels = 4.0f;
+
+    GameRenderer(sf::RenderWindow *window)
+        : window_(window), renderer_(window), view_(window->getDefaultView()), zoom_{1},
+          staticLayerVersion_{}, hasStaticLayer_{false}, hasCellGeometries_{false}
     {
+        // The static layer holds what the window shows, so it is sized in screen pixels.
+        staticLayer_.create(window->getSize().x, window->getSize().y);
+        summaryLayer_.create(GameManagerConfig::kBoardWidth, GameManagerConfig::kBoardHeight);
+        summaryPixels_.resize(4 * GameManagerConfig::kBoardWidth * GameManagerConfig::kBoardHeight);
+
+        // A few bands per thread, so a band crowded with dirty cells does not hold up the frame.
+        std::size_t bandCount = workers_.GetThreadCount() * kBandsPerThread;
+        for (std::size_t k = 0; k < bandCount; ++k)
+        {
+            bands_.push_back({0, 0, renderer_.CreateWorkerBuilder(), renderer_.CreateWorkerBuilder()});
+        }
     }
 
     void Render(const Feis::IGameInfo &gameManagerInfo)
     {
         renderer_.Clear();
+        window_->setView(view_);
+
+        if (TGameRendererConfig::kCellSize / zoom_ < kSummaryCellPixels)
+        {
+            RenderSummary(gameManagerInfo);
+        }
+        else
+        {
+            RenderCells(gameManagerInfo);
+        }
+
+        window_->setView(window_->getDefaultView());
+
+        int timeLeft = gameManagerInfo.GetEndTime() - gameManagerInfo.GetElapsedTime();
+
+        renderer_.DrawText(
+            std::to_string(timeLeft / (TGameRendererConfig::kTicksPerSecond * 60) / 10) +
+            std::to_string(timeLeft / (TGameRendererConfig::kTicksPerSecond * 60) % 10) +
+            ":" +
+            std::to_string(timeLeft / (TGameRendererConfig::kTicksPerSecond) % 60 / 10) +
+            std::to_string(timeLeft / (TGameRendererConfig::kTicksPerSecond) % 10),
+            20,
+            sf::Color::White,
+            sf::Vector2f(50, 30));
+        renderer_.Flush();
+
+        renderer_.Display();
+    }
+
+    // Passes two and three redraw only the cells the game reports dirty, so consecutive calls must
+    // render consecutive snapshots of one game; call this before switching to an unrelated state.
+    void Invalidate()
+    {
+        hasStaticLayer_ = false;
+        hasCellGeometries_ = false;
+        summary_.Invalidate();
+    }
+
+    // Zooms by `factor` (above 1 zooms out) keeping the point under `pixel` in place.
+    void Zoom(float factor, sf::Vector2i pixel)
+    {
+        factor = std::clamp(zoom_ * factor, kMinZoom, kMaxZoom) / zoom_;
+
+        sf::Vector2f before = window_->mapPixelToCoords(pixel, view_);
+        view_.zoom(factor);
+        zoom_ *= factor;
+        view_.move(before - window_->mapPixelToCoords(pixel, view_));
+    }
+
+    // Moves the board by a distance in screen pixels.
+    void Pan(sf::Vector2i pixels)
+    {
+        view_.move(-zoom_ * sf::Vector2f(pixels));
+    }
+
+    void ResetView()
+    {
+        view_ = window_->getDefaultView();
+        zoom_ = 1;
+    }
+
+    // The cell under a window pixel; it may lie outside the board.
+    CellPosition GetCellPosition(sf::Vector2i pixel) const
+    {
+        sf::Vector2f position =
+            window_->mapPixelToCoords(pixel, view_) -
+            sf::Vector2f(TGameRendererConfig::kBoardLeft, TGameRendererConfig::kBoardTop);
+        return {static_cast<int>(std::floor(position.y / TGameRendererConfig::kCellSize)),
+                static_cast<int>(std::floor(position.x / TGameRendererConfig::kCellSize))};
+    }
 
-        for (int row = 0; row < GameManagerConfig::kBoardHeight; ++row)
+private:
+    using Builder = GeometryBuilder<TGameRendererConfig>;
+
+    static constexpr std::size_t kBandsPerThread = 4;
+
+    // Cells [firstRow, lastRow) x [firstCol, lastCol).
+    struct CellRange
+    {
+        int firstRow;
+        int lastRow;
+        int firstCol;
+        int lastCol;
+
+        bool Contains(CellPosition cellPosition) const
         {
-            for (int col = 0; col < GameManagerConfig::kBoardWidth; ++col)
+            return cellPosition.row >= firstRow && cellPosition.row < lastRow &&
+                   cellPosition.col >= firstCol && cellPosition.col < lastCol;
+        }
+    };
+
+    // Rows [firstRow, lastRow) of the visible range and the geometry built for them.
+    struct Band
+    {
+        int firstRow;
+        int lastRow;
+        Builder passTwo;
+        Builder passThree;
+    };
+
+    // The cells inside the view, widened by one cell for circles that overhang their cell and by
+    // the collection center's size up and left, since it is drawn from its top-left cell.
+    CellRange GetVisibleCells() const
+    {
+        sf::Vector2f topLeft =
+            view_.getCenter() - view_.getSize() / 2.0f -
+            sf::Vector2f(TGameRendererConfig::kBoardLeft, TGameRendererConfig::kBoardTop);
+        sf::Vector2f bottomRight = topLeft + view_.getSize();
+
+        auto toCell = [](float coordinate)
+        { return static_cast<int>(std::floor(coordinate / TGameRendererConfig::kCellSize)); };
+
+        return {
+            std::max(toCell(topLeft.y) - static_cast<int>(GameManagerConfig::kGoalSize), 0),
+            std::min(toCell(bottomRight.y) + 2, GameManagerConfig::kBoardHeight),
+            std::max(toCell(topLeft.x) - static_cast<int>(GameManagerConfig::kGoalSize), 0),
+            std::min(toCell(bottomRight.x) + 2, GameManagerConfig::kBoardWidth)};
+    }
+
+    void RenderCells(const Feis::IGameInfo &gameManagerInfo)
+    {
+        CellRange visible = GetVisibleCells();
+
+        if (!hasStaticLayer_ || staticLayerVersion_ != gameManagerInfo.GetBoardVersion() ||
+            staticLayerView_.getCenter() != view_.getCenter() || staticLayerView_.getSize() != view_.getSize())
+        {
+            RenderStaticLayer(gameManagerInfo, visible);
+        }
+        window_->setView(window_->getDefaultView());
+        renderer_.DrawLayer(staticLayer_.getTexture());
+        window_->setView(view_);
+
+        // Passes two and three are built band by band on the workers; the bands are then appended
+        // in row order, so each pass is still submitted as one batch in the order it used to be.
+        int rowCount = std::max(visible.lastRow - visible.firstRow, 0);
+        for (std::size_t k = 0; k < bands_.size(); ++k)
+        {
+            bands_[k].firstRow = visible.firstRow + static_cast<int>(k * rowCount / bands_.size());
+            bands_[k].lastRow = visible.firstRow + static_cast<int>((k + 1) * rowCount / bands_.size());
+        }
+
+        if (workers_.GetThreadCount() == 1)
+        {
+            for (Band &band : bands_)
             {
-                layeredCellRenderer_.RenderPassOne(gameManagerInfo, renderer_, {row, col});
+                RenderBand(gameManagerInfo, band, visible);
             }
         }
+        else
+        {
+            for (Band &band : bands_)
+            {
+                workers_.Submit([this, &gameManagerInfo, &band, &visible]
+                                { RenderBand(gameManagerInfo, band, visible); });
+            }
+            workers_.Wait();
+        }
+
+        for (const Band &band : bands_)
+        {
+            renderer_.DrawGeometry(band.passTwo.GetGeometry());
+        }
+        renderer_.Flush();
 
-        for (int row = 0; row < GameManagerConfig::kBoardHeight; ++row)
+        for (const Band &band : bands_)
         {
-            for (int col = 0; col < GameManagerConfig::kBoardWidth; ++col)
+            renderer_.DrawGeometry(band.passThree.GetGeometry());
+        }
+        renderer_.Flush();
+
+        hasCellGeometries_ = true;
+        cachedCells_ = visible;
+    }
+
+    // Each band only touches the cached geometries of its own cells, and the game is only read.
+    // Cells that were culled last frame missed their dirty marks, so they are redrawn too.
+    void RenderBand(const Feis::IGameInfo &gameManagerInfo, Band &band, const CellRange &visible)
+    {
+        band.passTwo.ClearGeometry();
+        band.passThree.ClearGeometry();
+
+        for (int row = band.firstRow; row < band.lastRow; ++row)
+        {
+            for (int col = visible.firstCol; col < visible.lastCol; ++col)
             {
-                layeredCellRenderer_.RenderPassTwo(gameManagerInfo, renderer_, {row, col});
+                bool dirty =
+                    !hasCellGeometries_ || !cachedCells_.Contains({row, col}) || gameManagerInfo.IsCellDirty({row, col});
+                layeredCellRenderer_.RenderCachedPassTwo(gameManagerInfo, band.passTwo, {row, col}, dirty);
+                layeredCellRenderer_.RenderCachedPassThree(gameManagerInfo, band.passThree, {row, col}, dirty);
             }
         }
+    }
 
-        for (int row = 0; row < GameManagerConfig::kBoardHeight; ++row)
+    // One pixel per cell, coloured from the summary and stretched over the board.
+    void RenderSummary(const Feis::IGameInfo &gameManagerInfo)
+    {
+        if (summary_.Update(gameManagerInfo))
         {
-            for (int col = 0; col < GameManagerConfig::kBoardWidth; ++col)
+            for (int row = 0; row < GameManagerConfig::kBoardHeight; ++row)
             {
-                layeredCellRenderer_.RenderPassThree(gameManagerInfo, renderer_, {row, col});
+                for (int col = 0; col < GameManagerConfig::kBoardWidth; ++col)
+                {
+                    sf::Color color = BoardSummary::GetColor(summary_.Get({row, col}));
+                    sf::Uint8 *pixel = &summaryPixels_[4 * (row * GameManagerConfig::kBoardWidth + col)];
+                    pixel[0] = color.r;
+                    pixel[1] = color.g;
+                    pixel[2] = color.b;
+                    pixel[3] = color.a;
+                }
             }
+            summaryLayer_.update(summaryPixels_.data());
         }
 
-        int timeLeft = gameManagerInfo.GetEndTime() - gameManagerInfo.GetElapsedTime();
+        sf::Sprite sprite(summaryLayer_);
+        sprite.setPosition(renderer_.GetBorderTopLeft());
+        sprite.setScale(TGameRendererConfig::kCellSize, TGameRendererConfig::kCellSize);
+        window_->draw(sprite);
 
-        renderer_.DrawText(
-            std::to_string(timeLeft / (TGameRendererConfig::kFPS * 60) / 10) +
-            std::to_string(timeLeft / (TGameRendererConfig::kFPS * 60) % 10) + 
-            ":" + 
-            std::to_string(timeLeft / (TGameRendererConfig::kFPS) % 60 / 10) +
-            std::to_string(timeLeft / (TGameRendererConfig::kFPS) % 10), 
-            20,
-            sf::Color::White,
-            sf::Vector2f(50, 30));
+        // The cached geometries keep going stale while no cell is drawn.
+        cachedCells_ = {0, 0, 0, 0};
+    }
 
+    // Pass one only draws backgrounds, borders and entity bodies, none of which change unless an
+    // entity is built or removed. The visible cells are rendered off-screen through the current
+    // view into a layer the size of the window, which is reused until the board version or the
+    // view changes; being in screen pixels, it stays sharp at any zoom.
+    void RenderStaticLayer(const Feis::IGameInfo &gameManagerInfo, const CellRange &visible)
+    {
+        if (staticLayer_.getSize() != window_->getSize())
+        {
+            staticLayer_.create(window_->getSize().x, window_->getSize().y);
+        }
 
-        renderer_.Display();
+        renderer_.SetTarget(&staticLayer_);
+        staticLayer_.setView(view_);
+        staticLayer_.clear(sf::Color::Black);
+
+        for (int row = visible.firstRow; row < visible.lastRow; ++row)
+        {
+            for (int col = visible.firstCol; col < visible.lastCol; ++col)
+            {
+                layeredCellRenderer_.RenderPassOne(gameManagerInfo, renderer_, {row, col});
+            }
+        }
+        renderer_.Flush();
+
+        staticLayer_.display();
+        renderer_.ResetTarget();
+
+        staticLayerVersion_ = gameManagerInfo.GetBoardVersion();
+        staticLayerView_ = view_;
+        hasStaticLayer_ = true;
     }
 
-private:
+    sf::RenderWindow *window_;
     Drawer<TGameRendererConfig> renderer_;
-    LayeredCellRenderer<TGameRendererConfig> layeredCellRenderer_;
+    LayeredCellRenderer<TGameRendererConfig, Builder> layeredCellRenderer_;
+    Feis::ThreadPool workers_;
+    std::vector<Band> bands_;
+    sf::View view_;
+    float zoom_;
+    CellRange cachedCells_{0, 0, 0, 0};
+    sf::RenderTexture staticLayer_;
+    sf::View staticLayerView_;
+    std::size_t staticLayerVersion_;
+    bool hasStaticLayer_;
+    bool hasCellGeometries_;
+    BoardSummary summary_;
+    sf::Texture summaryLayer_;
+    std::vector<sf::Uint8> summaryPixels_;
 };
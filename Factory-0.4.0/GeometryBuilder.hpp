@@ -0,0 +1,432 @@
+#ifndef GEOMETRY_BUILDER_HPP
+#define GEOMETRY_BUILDER_HPP
+#include <algorithm>
+#include <cmath>
+#include <map>
+#include <string>
+#include <unordered_map>
+#include <utility>
+#include <vector>
+
+// Glyph metrics of one font. sf::Font rasterizes glyphs into its texture pages on first use, which
+// only the rendering thread may do, so the characters the board can show are rasterized up front
+// by Warm and looked up read-only afterwards.
+class GlyphAtlas
+{
+public:
+    static constexpr unsigned int kMaxWarmCharacterSize = 64;
+
+    GlyphAtlas(const sf::Font *font) : font_(font)
+    {
+    }
+
+    // Rasterizes every character of `characters` at every size up to kMaxWarmCharacterSize,
+    // together with the kerning between them.
+    void Warm(const std::string &characters)
+    {
+        for (unsigned int characterSize = 1; characterSize <= kMaxWarmCharacterSize; ++characterSize)
+        {
+            for (char previous : characters)
+            {
+                Get(static_cast<unsigned char>(previous), characterSize);
+
+                for (char current : characters)
+                {
+                    GetKerning(static_cast<unsigned char>(previous), static_cast<unsigned char>(current), characterSize);
+                }
+            }
+        }
+    }
+
+    // Thread-safe as long as no Get runs at the same time; nullptr if the glyph was never
+    // rasterized.
+    const sf::Glyph *Find(sf::Uint32 character, unsigned int characterSize) const
+    {
+        auto page = pages_.find(characterSize);
+        if (page == pages_.end())
+            return nullptr;
+
+        auto it = page->second.glyphs.find(character);
+        return it == page->second.glyphs.end() ? nullptr : &it->second;
+    }
+
+    float FindKerning(sf::Uint32 previous, sf::Uint32 current, unsigned int characterSize) const
+    {
+        auto page = pages_.find(characterSize);
+        if (page == pages_.end())
+            return 0;
+
+        auto it = page->second.kernings.find({previous, current});
+        return it == page->second.kernings.end() ? 0 : it->second;
+    }
+
+    // Rendering thread only.
+    const sf::Glyph &Get(sf::Uint32 character, unsigned int characterSize)
+    {
+        auto &glyphs = pages_[characterSize].glyphs;
+        auto it = glyphs.find(character);
+        if (it == glyphs.end())
+        {
+            it = glyphs.emplace(character, font_->getGlyph(character, characterSize, false)).first;
+        }
+        return it->second;
+    }
+
+    float GetKerning(sf::Uint32 previous, sf::Uint32 current, unsigned int characterSize)
+    {
+        auto &kernings = pages_[characterSize].kernings;
+        auto it = kernings.find({previous, current});
+        if (it == kernings.end())
+        {
+            it = kernings.emplace(std::make_pair(previous, current), font_->getKerning(previous, current, characterSize)).first;
+        }
+        return it->second;
+    }
+
+    const sf::Texture &GetTexture(unsigned int characterSize) const
+    {
+        return font_->getTexture(characterSize);
+    }
+
+private:
+    struct Page
+    {
+        std::unordered_map<sf::Uint32, sf::Glyph> glyphs;
+        std::map<std::pair<sf::Uint32, sf::Uint32>, float> kernings;
+    };
+
+    const sf::Font *font_;
+    std::map<unsigned int, Page> pages_;
+};
+
+// Turns drawing calls into vertices: shapes into one triangle list and text glyphs into one
+// textured triangle list per character size. It never touches a render target, so one builder per
+// thread can build geometry for different cells at the same time; a builder that may not rasterize
+// glyphs skips characters its atlas has not warmed.
+template <typename TGameRendererConfig>
+class GeometryBuilder
+{
+public:
+    using CellPosition = Feis::CellPosition;
+    using Direction = Feis::Direction;
+
+    struct Geometry
+    {
+        std::vector<sf::Vertex> triangles;
+        std::map<unsigned int, std::vector<sf::Vertex>> texts;
+    };
+
+    GeometryBuilder(GlyphAtlas *atlas, bool canRasterize)
+        : atlas_(atlas), canRasterize_(canRasterize)
+    {
+    }
+
+    // Until EndRecording, drawing calls replace the contents of geometry instead of adding to the
+    // builder's own.
+    void BeginRecording(Geometry *geometry)
+    {
+        geometry->triangles.clear();
+        geometry->texts.clear();
+        recording_ = geometry;
+    }
+
+    void EndRecording()
+    {
+        recording_ = nullptr;
+    }
+
+    void DrawGeometry(const Geometry &geometry)
+    {
+        Geometry &output = GetOutput();
+        output.triangles.insert(output.triangles.end(), geometry.triangles.begin(), geometry.triangles.end());
+
+        for (const auto &[characterSize, vertices] : geometry.texts)
+        {
+            std::vector<sf::Vertex> &batch = output.texts[characterSize];
+            batch.insert(batch.end(), vertices.begin(), vertices.end());
+        }
+    }
+
+    const Geometry &GetGeometry() const { return geometry_; }
+
+    // Empties the builder's own geometry but keeps its capacity.
+    void ClearGeometry()
+    {
+        geometry_.triangles.clear();
+        for (auto &[characterSize, vertices] : geometry_.texts)
+        {
+            vertices.clear();
+        }
+    }
+
+    void DrawBorder(CellPosition cellPosition)
+    {
+        sf::Vector2f topLeft = GetCellTopLeft(cellPosition);
+        sf::Vector2f border(TGameRendererConfig::kBorderSize, TGameRendererConfig::kBorderSize);
+
+        AppendRectangle(
+            topLeft,
+            sf::Vector2f(TGameRendererConfig::kCellSize, TGameRendererConfig::kCellSize),
+            sf::Color(60, 60, 60));
+        AppendRectangle(
+            topLeft + border,
+            sf::Vector2f(TGameRendererConfig::kCellSize, TGameRendererConfig::kCellSize) - 2.0f * border,
+            sf::Color::Black);
+    }
+
+    // Lays the string out the way sf::Text does, centred on position.
+    void DrawText(
+        std::string str,
+        unsigned int characterSize,
+        sf::Color color,
+        sf::Vector2f position,
+        Direction direction = Direction::kTop)
+    {
+        constexpr float kPadding = 1;
+        constexpr std::size_t kMaxInlineLength = 16;
+
+        struct GlyphQuad
+        {
+            sf::Vector2f topLeft;
+            sf::Vector2f bottomRight;
+            sf::FloatRect textureRect;
+        };
+
+        GlyphQuad inlineQuads[kMaxInlineLength];
+        std::vector<GlyphQuad> heapQuads;
+        GlyphQuad *quads = inlineQuads;
+        if (str.size() > kMaxInlineLength)
+        {
+            heapQuads.resize(str.size());
+            quads = heapQuads.data();
+        }
+
+        std::size_t count = 0;
+        sf::Vector2f min(0, 0);
+        sf::Vector2f max(0, 0);
+        float x = 0;
+        sf::Uint32 previous = 0;
+
+        for (char c : str)
+        {
+            sf::Uint32 current = static_cast<unsigned char>(c);
+            x += canRasterize_ ? atlas_->GetKerning(previous, current, characterSize)
+                               : atlas_->FindKerning(previous, current, characterSize);
+            previous = current;
+
+            const sf::Glyph *glyph = canRasterize_ ? &atlas_->Get(current, characterSize)
+                                                   : atlas_->Find(current, characterSize);
+            if (glyph == nullptr)
+                continue;
+
+            sf::Vector2f topLeft(x + glyph->bounds.left, glyph->bounds.top);
+            sf::Vector2f bottomRight = topLeft + sf::Vector2f(glyph->bounds.width, glyph->bounds.height);
+
+            min = count == 0 ? topLeft : sf::Vector2f(std::min(min.x, topLeft.x), std::min(min.y, topLeft.y));
+            max = count == 0 ? bottomRight : sf::Vector2f(std::max(max.x, bottomRight.x), std::max(max.y, bottomRight.y));
+
+            quads[count++] = {
+                topLeft - sf::Vector2f(kPadding, kPadding),
+                bottomRight + sf::Vector2f(kPadding, kPadding),
+                sf::FloatRect(
+                    glyph->textureRect.left - kPadding,
+                    glyph->textureRect.top - kPadding,
+                    glyph->textureRect.width + 2 * kPadding,
+                    glyph->textureRect.height + 2 * kPadding)};
+
+            x += glyph->advance;
+        }
+
+        if (count == 0)
+            return;
+
+        sf::Vector2f center = (min + max) / 2.0f;
+        std::vector<sf::Vertex> &batch = GetOutput().texts[characterSize];
+
+        for (std::size_t k = 0; k < count; ++k)
+        {
+            const GlyphQuad &quad = quads[k];
+            const sf::Vector2f corners[] = {
+                quad.topLeft - center,
+                sf::Vector2f(quad.bottomRight.x, quad.topLeft.y) - center,
+                quad.bottomRight - center,
+                sf::Vector2f(quad.topLeft.x, quad.bottomRight.y) - center};
+            const sf::Vector2f texCoords[] = {
+                {quad.textureRect.left, quad.textureRect.top},
+                {quad.textureRect.left + quad.textureRect.width, quad.textureRect.top},
+                {quad.textureRect.left + quad.textureRect.width, quad.textureRect.top + quad.textureRect.height},
+                {quad.textureRect.left, quad.textureRect.top + quad.textureRect.height}};
+
+            for (int i : {0, 1, 2, 0, 2, 3})
+            {
+                batch.push_back(sf::Vertex(position + Rotate(corners[i], direction), color, texCoords[i]));
+            }
+        }
+    }
+
+    void DrawText(
+        std::string str,
+        unsigned int characterSize,
+        sf::Color color,
+        CellPosition cellPosition,
+        Direction direction = Direction::kTop)
+    {
+        DrawText(str, characterSize, color, GetCellCenter(cellPosition), direction);
+    }
+
+    void DrawRectangle(CellPosition cellPosition, sf::Color color)
+    {
+        AppendRectangle(
+            GetCellTopLeft(cellPosition),
+            sf::Vector2f(TGameRendererConfig::kCellSize, TGameRendererConfig::kCellSize),
+            color);
+    }
+
+    void DrawRectangle(sf::Vector2f topLeft, sf::Vector2f size, sf::Color color)
+    {
+        AppendRectangle(topLeft, size, color);
+    }
+
+    void DrawTriangle(
+        sf::Vector2f center,
+        Direction direction,
+        sf::Color color)
+    {
+        constexpr float kHalf = TGameRendererConfig::kCellSize / 2.0f;
+        const sf::Vector2f points[] = {{-kHalf, -kHalf}, {kHalf, -kHalf}, {kHalf, kHalf}};
+
+        sf::Transform transform;
+        transform.translate(center).rotate((static_cast<int>(direction) + 1) * 90);
+        AppendPolygon(points, 3, transform, color);
+    }
+
+    void DrawTriangle(CellPosition cellPosition, Direction direction, sf::Color color)
+    {
+        DrawTriangle(GetCellCenter(cellPosition), direction, color);
+    }
+
+    void DrawCircle(sf::Vector2f center, float radius, sf::Color color)
+    {
+        AppendCircle(center, radius + 2, sf::Color(60, 60, 60));
+        AppendCircle(center, radius, color);
+    }
+
+    void DrawArrow(CellPosition cellPosition, Feis::Direction direction)
+    {
+        constexpr float kOffset = 2;
+        constexpr float kHalf = TGameRendererConfig::kCellSize / 2;
+        const sf::Vector2f points[] = {
+            {0, 0},
+            {-2 * kOffset, kOffset - kHalf},
+            {0, kOffset - kHalf},
+            {2 * kOffset, 0},
+            {0, kHalf - kOffset},
+            {-2 * kOffset, kHalf - kOffset}};
+
+        sf::Transform transform;
+        transform.translate(GetCellCenter(cellPosition)).rotate((static_cast<int>(direction) + 3) * 90);
+        AppendPolygon(points, 6, transform, sf::Color(60, 60, 60));
+    }
+
+    sf::Vector2f GetCellCenter(CellPosition cellPosition)
+    {
+        return GetCellTopLeft(cellPosition) + sf::Vector2f(TGameRendererConfig::kCellSize / 2, TGameRendererConfig::kCellSize / 2);
+    }
+    sf::Vector2f GetCellTopLeft(CellPosition cellPosition)
+    {
+        return GetBorderTopLeft() +
+               sf::Vector2f(cellPosition.col, cellPosition.row) * static_cast<float>(TGameRendererConfig::kCellSize);
+    }
+    sf::Vector2f GetBorderTopLeft()
+    {
+        return sf::Vector2f(TGameRendererConfig::kBoardLeft, TGameRendererConfig::kBoardTop);
+    }
+
+protected:
+    Geometry &GetOutput()
+    {
+        return recording_ ? *recording_ : geometry_;
+    }
+
+    GlyphAtlas *atlas_;
+    Geometry geometry_;
+
+private:
+    static constexpr std::size_t kCirclePointCount = 30;
+
+    // Quarter turns clockwise on screen, matching sf::Transformable::setRotation(90 * direction).
+    static sf::Vector2f Rotate(sf::Vector2f point, Direction direction)
+    {
+        switch (direction)
+        {
+        case Direction::kRight:
+            return {-point.y, point.x};
+        case Direction::kBottom:
+            return {-point.x, -point.y};
+        case Direction::kLeft:
+            return {point.y, -point.x};
+        default:
+            return point;
+        }
+    }
+
+    void AppendTriangle(sf::Vector2f a, sf::Vector2f b, sf::Vector2f c, sf::Color color)
+    {
+        std::vector<sf::Vertex> &triangles = GetOutput().triangles;
+        triangles.push_back(sf::Vertex(a, color));
+        triangles.push_back(sf::Vertex(b, color));
+        triangles.push_back(sf::Vertex(c, color));
+    }
+
+    void AppendRectangle(sf::Vector2f topLeft, sf::Vector2f size, sf::Color color)
+    {
+        sf::Vector2f topRight = topLeft + sf::Vector2f(size.x, 0);
+        sf::Vector2f bottomLeft = topLeft + sf::Vector2f(0, size.y);
+        sf::Vector2f bottomRight = topLeft + size;
+
+        AppendTriangle(topLeft, topRight, bottomRight, color);
+        AppendTriangle(topLeft, bottomRight, bottomLeft, color);
+    }
+
+    // Fans out from the centre of the points' bounding box, as sf::ConvexShape does, so the
+    // arrow outline (which is not convex) fills the same area as before.
+    void AppendPolygon(const sf::Vector2f *points, std::size_t count, const sf::Transform &transform, sf::Color color)
+    {
+        sf::Vector2f min = points[0];
+        sf::Vector2f max = points[0];
+        for (std::size_t i = 1; i < count; ++i)
+        {
+            min = sf::Vector2f(std::min(min.x, points[i].x), std::min(min.y, points[i].y));
+            max = sf::Vector2f(std::max(max.x, points[i].x), std::max(max.y, points[i].y));
+        }
+
+        sf::Vector2f center = transform.transformPoint((min + max) / 2.0f);
+        for (std::size_t i = 0; i < count; ++i)
+        {
+            AppendTriangle(
+                center,
+                transform.transformPoint(points[i]),
+                transform.transformPoint(points[(i + 1) % count]),
+                color);
+        }
+    }
+
+    void AppendCircle(sf::Vector2f center, float radius, sf::Color color)
+    {
+        for (std::size_t i = 0; i < kCirclePointCount; ++i)
+        {
+            float first = 2 * 3.14159265f * i / kCirclePointCount;
+            float second = 2 * 3.14159265f * (i + 1) / kCirclePointCount;
+
+            AppendTriangle(
+                center,
+                center + radius * sf::Vector2f(std::cos(first), std::sin(first)),
+                center + radius * sf::Vector2f(std::cos(second), std::sin(second)),
+                color);
+        }
+    }
+
+    bool canRasterize_;
+    Geometry *recording_ = nullptr;
+};
+#endif
@@ -1,20 +1,63 @@
 #ifndef LAYERED_CELL_RENDERER_HPP
 #define LAYERED_CELL_RENDERER_HPP
+#include <vector>
 #include "Drawer.hpp"
 #include "CellRendererFirstPassVisitor.hpp"
 #include "CellRendererSecondPassVisitor.hpp"
 #include "CellRendererThirdPassVisitor.hpp"
 
-template<typename TGameRendererConfig>
+template <typename TGameRendererConfig, typename TDrawer = Drawer<TGameRendererConfig>>
 class LayeredCellRenderer
 {
 public:
     using IGameInfo = Feis::IGameInfo;
     using CellPosition = Feis::CellPosition;
+    using GameManagerConfig = Feis::GameManagerConfig;
+    using Geometry = typename TDrawer::Geometry;
+
+    LayeredCellRenderer()
+        : passTwoGeometries_(GameManagerConfig::kBoardHeight * GameManagerConfig::kBoardWidth),
+          passThreeGeometries_(GameManagerConfig::kBoardHeight * GameManagerConfig::kBoardWidth)
+    {
+    }
+
+    // Like RenderPassTwo and RenderPassThree, but the geometry of each cell is kept and replayed
+    // as is unless the cell is dirty.
+    void RenderCachedPassTwo(
+        const IGameInfo &info,
+        TDrawer &drawer,
+        CellPosition cellPosition,
+        bool dirty)
+    {
+        Geometry &geometry = passTwoGeometries_[GetIndex(cellPosition)];
+        if (dirty)
+        {
+            drawer.BeginRecording(&geometry);
+            RenderPassTwo(info, drawer, cellPosition);
+            drawer.EndRecording();
+        }
+        drawer.DrawGeometry(geometry);
+    }
+
+    void RenderCachedPassThree(
+        const IGameInfo &info,
+        TDrawer &drawer,
+        CellPosition cellPosition,
+        bool dirty)
+    {
+        Geometry &geometry = passThreeGeometries_[GetIndex(cellPosition)];
+        if (dirty)
+        {
+            drawer.BeginRecording(&geometry);
+            RenderPassThree(info, drawer, cellPosition);
+            drawer.EndRecording();
+        }
+        drawer.DrawGeometry(geometry);
+    }
 
     void RenderPassOne(
         const IGameInfo &info,
-        Drawer<TGameRendererConfig> &renderer, 
+        TDrawer &renderer, 
         CellPosition position) const
     {
         auto& layeredCell = info.GetLayeredCell(position);
@@ -24,14 +67,14 @@ public:
 
         if (foreground)
         {
-            CellRendererFirstPassVisitor<TGameRendererConfig> cellRenderer(&info, &renderer, position, background.get());
+            CellRendererFirstPassVisitor<TGameRendererConfig, TDrawer> cellRenderer(&info, &renderer, position, background.get());
             foreground->Accept(&cellRenderer);
             return;
         }
 
         if (background)
         {
-            CellRendererFirstPassVisitor<TGameRendererConfig> cellRenderer(&info, &renderer, position, background.get());
+            CellRendererFirstPassVisitor<TGameRendererConfig, TDrawer> cellRenderer(&info, &renderer, position, background.get());
             background->Accept(&cellRenderer);
             return;
         }
@@ -41,7 +84,7 @@ public:
 
     void RenderPassTwo(
         const IGameInfo &info,
-        Drawer<TGameRendererConfig> &drawer,
+        TDrawer &drawer,
         CellPosition cellPosition) const
     {
         auto& layeredCell = info.GetLayeredCell(cellPosition);
@@ -50,14 +93,14 @@ public:
 
         if (foreground)
         {
-            CellRendererSecondPassVisitor<TGameRendererConfig> cellRenderer(&info, &drawer, cellPosition);
+            CellRendererSecondPassVisitor<TGameRendererConfig, TDrawer> cellRenderer(&info, &drawer, cellPosition);
             foreground->Accept(&cellRenderer);
         }
     }
 
     void RenderPassThree(
         const IGameInfo &info,
-        Drawer<TGameRendererConfig> &drawer,
+        TDrawer &drawer,
         CellPosition cellPosition) const
     {
         auto& layeredCell = info.GetLayeredCell(cellPosition);
@@ -65,9 +108,18 @@ public:
         auto foreground = layeredCell.GetForeground();
         if (foreground)
         {
-            CellRendererThirdPassVisitor<TGameRendererConfig> cellRenderer(&info, &drawer, cellPosition);
+            CellRendererThirdPassVisitor<TGameRendererConfig, TDrawer> cellRenderer(&info, &drawer, cellPosition);
             foreground->Accept(&cellRenderer);
         }
     }
+
+private:
+    static std::size_t GetIndex(CellPosition cellPosition)
+    {
+        return cellPosition.row * GameManagerConfig::kBoardWidth + cellPosition.col;
+    }
+
+    std::vector<Geometry> passTwoGeometries_;
+    std::vector<Geometry> passThreeGeometries_;
 };
 #endif
\ No newline at end of file
@@ -0,0 +1,419 @@
+#define USE_HEADLESS
+#include <iostream>
+#include <vector>
+#include <deque>
+#include <map>
+#include <mutex>
+#include <chrono>
+#include <cstdint>
+#include <algorithm>
+
+#include "PDOGS.cpp"
+#include "ConveyorRouter.hpp"
+#include "CombinerPlanner.hpp"
+#include "ScriptedGamePlayer.hpp"
+#include "BeamSearchGamePlayer.hpp"
+#include "ThreadPool.hpp"
+#include "Replay.hpp"
+
+using namespace Feis;
+
+struct LayoutOptimizerConfig
+{
+    static constexpr std::size_t kPopulationSize = 32;
+    static constexpr std::size_t kEliteCount = 4;
+    static constexpr std::size_t kTournamentSize = 3;
+    static constexpr std::size_t kSnapshotInterval = 16;
+    static constexpr std::size_t kMaxSnapshots = 512;
+    static constexpr std::size_t kMaxPlanSize = GameManagerConfig::kEndTime / 3;
+};
+
+// Games captured right after the first n actions of some plan were issued, keyed by n and a hash
+// of those actions. Evaluating a plan resumes from the longest cached prefix it shares instead of
+// replaying from tick 0. The oldest snapshots are evicted first.
+class PrefixSnapshotCache
+{
+public:
+    using Key = std::pair<std::size_t, std::uint64_t>;
+
+    std::shared_ptr<const GameManager> Find(const Key &key)
+    {
+        std::lock_guard<std::mutex> lock(mutex_);
+        auto it = snapshots_.find(key);
+        if (it == snapshots_.end())
+            return nullptr;
+
+        ++hitCount_;
+        return it->second;
+    }
+
+    void Insert(const Key &key, std::shared_ptr<const GameManager> snapshot)
+    {
+        std::lock_guard<std::mutex> lock(mutex_);
+        if (!snapshots_.emplace(key, std::move(snapshot)).second)
+            return;
+
+        order_.push_back(key);
+        while (order_.size() > LayoutOptimizerConfig::kMaxSnapshots)
+        {
+            snapshots_.erase(order_.front());
+            order_.pop_front();
+        }
+    }
+
+    std::size_t GetHitCount() const
+    {
+        std::lock_guard<std::mutex> lock(mutex_);
+        return hitCount_;
+    }
+
+private:
+    mutable std::mutex mutex_;
+    std::map<Key, std::shared_ptr<const GameManager>> snapshots_;
+    std::deque<Key> order_;
+    std::size_t hitCount_ = 0;
+};
+
+// Evolves build plans for one (divisor, seed). A plan is a sequence of layouts drawn from a gene
+// pool of planner layouts; its fitness is the score of a full headless game that replays it.
+class LayoutOptimizer
+{
+public:
+    LayoutOptimizer(int commonDividor, unsigned int seed, ThreadPool *pool)
+        : commonDividor_{commonDividor}, seed_{seed}, pool_{pool}, gen_(seed)
+    {
+        BuildGenePool();
+
+        population_.resize(LayoutOptimizerConfig::kPopulationSize);
+        population_[0].genes = greedyGenes_;
+        for (std::size_t i = 1; i < population_.size(); ++i)
+        {
+            population_[i].genes = greedyGenes_;
+            std::shuffle(population_[i].genes.begin() + population_[i].genes.size() / 2, population_[i].genes.end(), gen_);
+            Mutate(population_[i].genes);
+        }
+    }
+
+    // Evaluates the population in parallel and breeds the next one. Returns the best score so far.
+    int Step()
+    {
+        for (Individual &individual : population_)
+        {
+            if (!individual.evaluated)
+            {
+                Individual *target = &individual;
+                pool_->Submit([this, target]
+                              { target->fitness = Evaluate(Decode(target->genes));
+                                target->evaluated = true; });
+            }
+        }
+        pool_->Wait();
+
+        std::stable_sort(
+            population_.begin(),
+            population_.end(),
+            [](const Individual &lhs, const Individual &rhs)
+            { return lhs.fitness > rhs.fitness; });
+
+        if (population_[0].fitness > best_.fitness || !best_.evaluated)
+        {
+            best_ = population_[0];
+        }
+
+        std::vector<Individual> next(population_.begin(), population_.begin() + LayoutOptimizerConfig::kEliteCount);
+        while (next.size() < population_.size())
+        {
+            const Individual &first = Select();
+            const Individual &second = Select();
+
+            Individual child;
+            child.genes = Crossover(first.genes, second.genes);
+            Mutate(child.genes);
+            next.push_back(std::move(child));
+        }
+        population_ = std::move(next);
+
+        return best_.fitness;
+    }
+
+    std::queue<PlayerAction> GetBestPlan() const
+    {
+        std::queue<PlayerAction> plan;
+        for (const PlayerAction &action : Decode(best_.genes))
+        {
+            plan.push(action);
+        }
+        return plan;
+    }
+
+    std::size_t GetEvaluationCount() const { return evaluationCount_; }
+
+    std::size_t GetSnapshotHitCount() const { return snapshots_.GetHitCount(); }
+
+private:
+    struct Individual
+    {
+        std::vector<std::size_t> genes;
+        int fitness = 0;
+        bool evaluated = false;
+    };
+
+    // The gene pool holds the layouts of the greedy planner, in the order it commits them, followed
+    // by every layout that can be built on the empty board.
+    void BuildGenePool()
+    {
+        ScriptedGamePlayer player;
+        GameManager game(&player, commonDividor_, seed_);
+        CombinerPlanner planner(game);
+
+        ConveyorRouter router(game);
+        std::size_t planSize = 0;
+        while (true)
+        {
+            std::vector<std::queue<PlayerAction>> layouts = planner.GetLayouts(game, router);
+            if (layouts.empty())
+                break;
+
+            auto best = std::min_element(
+                layouts.begin(),
+                layouts.end(),
+                [](const std::queue<PlayerAction> &lhs, const std::queue<PlayerAction> &rhs)
+                { return lhs.size() < rhs.size(); });
+
+            planSize += best->size();
+            if (planSize > LayoutOptimizerConfig::kMaxPlanSize)
+                break;
+
+            CombinerPlanner::Commit(*best, router);
+            greedyGenes_.push_back(genePool_.size());
+            genePool_.push_back(ToVector(*best));
+        }
+
+        ConveyorRouter emptyRouter(game);
+        for (const std::queue<PlayerAction> &layout : planner.GetLayouts(game, emptyRouter))
+        {
+            genePool_.push_back(ToVector(layout));
+        }
+    }
+
+    static std::vector<PlayerAction> ToVector(std::queue<PlayerAction> actions)
+    {
+        std::vector<PlayerAction> result;
+        while (!actions.empty())
+        {
+            result.push_back(actions.front());
+            actions.pop();
+        }
+        return result;
+    }
+
+    std::vector<PlayerAction> Decode(const std::vector<std::size_t> &genes) const
+    {
+        std::vector<PlayerAction> plan;
+        for (std::size_t gene : genes)
+        {
+            plan.insert(plan.end(), genePool_[gene].begin(), genePool_[gene].end());
+        }
+        if (plan.size() > LayoutOptimizerConfig::kMaxPlanSize)
+        {
+            plan.resize(LayoutOptimizerConfig::kMaxPlanSize);
+        }
+        return plan;
+    }
+
+    static std::uint64_t HashAction(std::uint64_t hash, const PlayerAction &action)
+    {
+        hash ^= static_cast<std::uint64_t>(action.type) + 0x9e3779b97f4a7c15ULL + (hash << 6) + (hash >> 2);
+        hash ^= static_cast<std::uint64_t>(action.cellPosition.row * GameManagerConfig::kBoardWidth + action.cellPosition.col) +
+                0x9e3779b97f4a7c15ULL + (hash << 6) + (hash >> 2);
+        return hash;
+    }
+
+    // Action i is issued at tick 3 * (i + 1), so the game right after tick 3 * n has seen exactly
+    // the first n actions of the plan and nothing else.
+    int Evaluate(const std::vector<PlayerAction> &plan)
+    {
+        std::vector<std::uint64_t> prefixHashes(plan.size() + 1);
+        for (std::size_t i = 0; i < plan.size(); ++i)
+        {
+            prefixHashes[i + 1] = HashAction(prefixHashes[i], plan[i]);
+        }
+
+        std::size_t start = plan.size() / LayoutOptimizerConfig::kSnapshotInterval * LayoutOptimizerConfig::kSnapshotInterval;
+        std::shared_ptr<const GameManager> snapshot;
+        for (; start > 0; start -= LayoutOptimizerConfig::kSnapshotInterval)
+        {
+            snapshot = snapshots_.Find({start, prefixHashes[start]});
+            if (snapshot)
+                break;
+        }
+
+        ScriptedGamePlayer player;
+        for (std::size_t i = start; i < plan.size(); ++i)
+        {
+            player.EnqueueAction(plan[i]);
+        }
+
+        std::unique_ptr<GameManager> game =
+            snapshot ? snapshot->Fork(&player) : std::make_unique<GameManager>(&player, commonDividor_, seed_);
+
+        while (!game->IsGameOver())
+        {
+            game->Update();
+
+            std::size_t issued = game->GetElapsedTime() / 3;
+            if (game->GetElapsedTime() % 3 == 0 && issued > start && issued <= plan.size() &&
+                issued % LayoutOptimizerConfig::kSnapshotInterval == 0)
+            {
+                snapshots_.Insert({issued, prefixHashes[issued]}, game->Fork(nullptr));
+            }
+        }
+
+        std::lock_guard<std::mutex> lock(statisticsMutex_);
+        ++evaluationCount_;
+        return game->GetScores();
+    }
+
+    const Individual &Select()
+    {
+        std::uniform_int_distribution<std::size_t> dis(0, population_.size() - 1);
+        std::size_t best = dis(gen_);
+        for (std::size_t k = 1; k < LayoutOptimizerConfig::kTournamentSize; ++k)
+        {
+            best = std::min(best, dis(gen_));
+        }
+        return population_[best];
+    }
+
+    // Keeps a prefix of the first parent so that the child can resume from its snapshots.
+    std::vector<std::size_t> Crossover(const std::vector<std::size_t> &first, const std::vector<std::size_t> &second)
+    {
+        std::uniform_int_distribution<std::size_t> firstDis(0, first.size());
+        std::uniform_int_distribution<std::size_t> secondDis(0, second.size());
+
+        std::vector<std::size_t> child(first.begin(), first.begin() + firstDis(gen_));
+        child.insert(child.end(), second.begin() + secondDis(gen_), second.end());
+        return child;
+    }
+
+    // Plans stay empty on boards where the planner finds no layout at all.
+    void Mutate(std::vector<std::size_t> &genes)
+    {
+        if (genePool_.empty())
+            return;
+
+        std::uniform_int_distribution<int> kindDis(0, 2);
+        std::uniform_int_distribution<std::size_t> poolDis(0, genePool_.size() - 1);
+
+        switch (kindDis(gen_))
+        {
+        case 0:
+        {
+            std::uniform_int_distribution<std::size_t> positionDis(0, genes.size());
+            genes.insert(genes.begin() + positionDis(gen_), poolDis(gen_));
+            break;
+        }
+        case 1:
+            if (!genes.empty())
+            {
+                std::uniform_int_distribution<std::size_t> positionDis(0, genes.size() - 1);
+                genes.erase(genes.begin() + positionDis(gen_));
+            }
+            break;
+        case 2:
+            if (genes.size() >= 2)
+            {
+                std::uniform_int_distribution<std::size_t> positionDis(0, genes.size() - 2);
+                std::size_t position = positionDis(gen_);
+                std::swap(genes[position], genes[position + 1]);
+            }
+            break;
+        }
+    }
+
+    int commonDividor_;
+    unsigned int seed_;
+    ThreadPool *pool_;
+    std::mt19937 gen_;
+    std::vector<std::vector<PlayerAction>> genePool_;
+    std::vector<std::size_t> greedyGenes_;
+    std::vector<Individual> population_;
+    Individual best_;
+    PrefixSnapshotCache snapshots_;
+    std::mutex statisticsMutex_;
+    std::size_t evaluationCount_ = 0;
+};
+
+// Plays one game with the beam search player, next to the greedy plan as a baseline.
+int RunBeamSearch(int commonDividor, unsigned int seed)
+{
+    ThreadPool pool;
+
+    ScriptedGamePlayer planningPlayer;
+    GameManager planningGame(&planningPlayer, commonDividor, seed);
+    ConveyorRouter router(planningGame);
+    CombinerPlanner planner(planningGame);
+    ScriptedGamePlayer greedyPlayer(planner.Plan(planningGame, router, LayoutOptimizerConfig::kMaxPlanSize));
+    GameManager greedyGame(&greedyPlayer, commonDividor, seed);
+    while (!greedyGame.IsGameOver())
+    {
+        greedyGame.Update();
+    }
+
+    BeamSearchGamePlayer<> beamPlayer(&pool);
+    GameManager beamGame(&beamPlayer, commonDividor, seed);
+    auto startTime = std::chrono::steady_clock::now();
+    while (!beamGame.IsGameOver())
+    {
+        beamGame.Update();
+    }
+    double seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - startTime).count();
+
+    std::cout << "beam search " << beamGame.GetScores() << " greedy " << greedyGame.GetScores()
+              << " seconds " << seconds << std::endl;
+    return 0;
+}
+
+int main(int argc, char **argv)
+{
+    if (argc >= 4 && std::string(argv[1]) == "beam")
+    {
+        return RunBeamSearch(std::stoi(argv[2]), static_cast<unsigned int>(std::stoul(argv[3])));
+    }
+
+    if (argc < 3)
+    {
+        std::cout << "Usage: LayoutOptimizer <divisor> <seed> [generations] [replay file]" << std::endl;
+        std::cout << "       LayoutOptimizer beam <divisor> <seed>" << std::endl;
+        return 1;
+    }
+
+    int commonDividor = std::stoi(argv[1]);
+    unsigned int seed = static_cast<unsigned int>(std::stoul(argv[2]));
+    int generations = argc > 3 ? std::stoi(argv[3]) : 100;
+    std::string filename = argc > 4 ? argv[4] : "best_plan.txt";
+
+    ThreadPool pool;
+    LayoutOptimizer optimizer(commonDividor, seed, &pool);
+
+    auto startTime = std::chrono::steady_clock::now();
+    int bestScore = -1;
+
+    for (int generation = 1; generation <= generations; ++generation)
+    {
+        int score = optimizer.Step();
+
+        if (score > bestScore)
+        {
+            bestScore = score;
+            SaveReplay(optimizer.GetBestPlan(), filename);
+        }
+
+        double seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - startTime).count();
+        std::cout << "generation " << generation
+                  << " best " << bestScore
+                  << " evaluations " << optimizer.GetEvaluationCount()
+                  << " snapshot hits " << optimizer.GetSnapshotHitCount()
+                  << " games/s " << optimizer.GetEvaluationCount() / seconds << std::endl;
+    }
+}
@@ -8,7 +8,16 @@
 #include <cassert>
 #include <set>
 #include <array>
+#include <bitset>
+#include <vector>
 #include <string>
+#include <optional>
+#include <atomic>
+#include <numeric>
+#include <typeinfo>
+#include <algorithm>
+#include <cstdint>
+#include <deque>
 
 namespace Feis
 {
@@ -20,6 +29,7 @@ namespace Feis
         static constexpr std::size_t kConveyorBufferSize = 10;
         static constexpr int kNumberOfWalls = 100;
         static constexpr std::size_t kEndTime = 9000;
+        static constexpr std::size_t kMaxPlayers = 8;
     };
 
     struct CellPosition
@@ -61,6 +71,10 @@ namespace Feis
 
     class LayeredCell;
 
+    class GameManager;
+
+    class IGamePlayer;
+
     class IGameInfo
     {
     public:
@@ -71,12 +85,33 @@ namespace Feis
         virtual int GetEndTime() const = 0;
         virtual int GetElapsedTime() const = 0;
         virtual bool IsGameOver() const = 0;
+        virtual std::size_t GetBoardVersion() const = 0;
+        virtual bool IsCellDirty(CellPosition cellPosition) const = 0;
+        // Copy of the game for look-ahead; see GameManager::Fork.
+        virtual std::unique_ptr<GameManager> Fork(IGamePlayer *player) const = 0;
+    };
+
+    struct DeliveryEvent
+    {
+        std::size_t tick;
+        int number;
+        bool scored;
+        std::size_t player;
+    };
+
+    // Told about every product a collection center receives, from the thread updating the game.
+    class IDeliveryEventSink
+    {
+    public:
+        virtual void OnDelivery(const DeliveryEvent &event) = 0;
     };
 
     class IGameManager : public IGameInfo
     {
     public:
-        virtual void OnProductReceived(int number) = 0;
+        // `player` owns the collection center that received the product.
+        virtual void OnProductReceived(int number, std::size_t player) = 0;
+        virtual int GetPlayerScores(std::size_t player) const = 0;
     };
 
     class Cell;
@@ -116,6 +151,12 @@ namespace Feis
     class ForegroundCell : public Cell
     {
     public:
+        struct CellState
+        {
+            std::array<int, GameManagerConfig::kConveyorBufferSize> products;
+            std::size_t elapsedTime;
+        };
+
         ForegroundCell(CellPosition topLeftCellPosition) : topLeftCellPosition_(topLeftCellPosition) {}
 
         virtual std::size_t GetWidth() const { return 1; }
@@ -134,6 +175,20 @@ namespace Feis
 
         virtual void UpdatePassTwo(CellPosition cellPosition, GameBoard &board) {}
 
+        // The neighbour whose capacity the part on cellPosition reads and which it sends products to.
+        virtual std::optional<Direction> GetOutputDirection(CellPosition cellPosition) const { return std::nullopt; }
+
+        // Whether GetCapacity and ReceiveProduct depend on or change the entity's state; a collection
+        // center always takes products and only adds them to the score.
+        virtual bool HasBufferedInput() const { return false; }
+
+        virtual CellState GetState() const { return {}; }
+
+        virtual void SetState(const CellState &state) {}
+
+        // Deep copy used when forking a game; gameManager is the game the copy will belong to.
+        virtual std::shared_ptr<ForegroundCell> Clone(IGameManager *gameManager) const = 0;
+
         virtual ~ForegroundCell() {}
 
     protected:
@@ -147,6 +202,45 @@ namespace Feis
         virtual void RenderPassTwo(CellPosition position) const = 0;
     };
 
+    bool operator==(const ForegroundCell::CellState &lhs, const ForegroundCell::CellState &rhs)
+    {
+        return lhs.products == rhs.products && lhs.elapsedTime == rhs.elapsedTime;
+    }
+
+    bool operator!=(const ForegroundCell::CellState &lhs, const ForegroundCell::CellState &rhs)
+    {
+        return !(lhs == rhs);
+    }
+
+    void HashCombine(std::size_t &hash, std::size_t value)
+    {
+        hash ^= value + 0x9e3779b97f4a7c15 + (hash << 6) + (hash >> 2);
+    }
+
+    // One cell's share of GameBoard::GetStateHash; kind is the typeid hash code of the entity. Kept
+    // apart so that other engines, with any buffer size, can hash their boards the same way.
+    template <std::size_t kBufferSize>
+    void HashForegroundCell(std::size_t &hash, std::size_t kind, CellPosition topLeftCellPosition,
+                            std::optional<Direction> outputDirection, const std::array<int, kBufferSize> &products,
+                            std::size_t elapsedTime)
+    {
+        HashCombine(hash, kind);
+        HashCombine(hash, topLeftCellPosition.row);
+        HashCombine(hash, topLeftCellPosition.col);
+        HashCombine(hash, outputDirection ? static_cast<std::size_t>(*outputDirection) + 1 : 0);
+        for (int product : products)
+        {
+            HashCombine(hash, product);
+        }
+        HashCombine(hash, elapsedTime);
+    }
+
+    void HashForegroundCell(std::size_t &hash, std::size_t kind, CellPosition topLeftCellPosition,
+                            std::optional<Direction> outputDirection, const ForegroundCell::CellState &state)
+    {
+        HashForegroundCell(hash, kind, topLeftCellPosition, outputDirection, state.products, state.elapsedTime);
+    }
+
     CellPosition GetNeighborCellPosition(CellPosition cellPosition, Direction direction)
     {
         switch (direction)
@@ -202,6 +296,16 @@ namespace Feis
             return products_.size();
         }
 
+        std::optional<Direction> GetOutputDirection(CellPosition cellPosition) const override
+        {
+            return direction_;
+        }
+
+        bool HasBufferedInput() const override
+        {
+            return true;
+        }
+
         void ReceiveProduct(CellPosition cellPosition, int number) override
         {
             assert(number != 0);
@@ -250,6 +354,21 @@ namespace Feis
             }
         }
 
+        CellState GetState() const override
+        {
+            return {products_, 0};
+        }
+
+        void SetState(const CellState &state) override
+        {
+            products_ = state.products;
+        }
+
+        std::shared_ptr<ForegroundCell> Clone(IGameManager *gameManager) const override
+        {
+            return std::make_shared<ConveyorCell>(*this);
+        }
+
     protected:
         std::array<int, GameManagerConfig::kConveyorBufferSize> products_;
 
@@ -257,17 +376,50 @@ namespace Feis
         Direction direction_;
     };
 
+    // Where a combiner's time goes, counted once per tick on its main cell. Not part of the cell
+    // state, so neither hashed nor saved.
+    struct CombinerStats
+    {
+        std::size_t combinedCount = 0;
+        // Both slots empty.
+        std::size_t idleTicks = 0;
+        // Only the second slot holds products, so the first input line is awaited.
+        std::size_t waitingForFirstTicks = 0;
+        // Only the first slot holds products, so the second input line is awaited.
+        std::size_t waitingForSecondTicks = 0;
+        // Both slots hold products but the outlet cannot take the sum.
+        std::size_t outletBlockedTicks = 0;
+        // A full slot, which stops the conveyor line feeding it.
+        std::size_t firstSlotFullTicks = 0;
+        std::size_t secondSlotFullTicks = 0;
+        // Sum over ticks of the products held; divided by 2 * combinedCount it is the mean time a
+        // product waits in a slot.
+        std::size_t heldProductTicks = 0;
+    };
+
     class CombinerCell : public ForegroundCell
     {
     public:
-        CombinerCell(CellPosition topLeft, Direction direction)
-            : ForegroundCell(topLeft), direction_{direction}, firstSlotProduct_{}, secondSlotProduct_{} {}
+        // Each slot is a queue of up to inputDepth products. The rules have one product per slot;
+        // deeper slots are for sandbox experiments. Slot k of the first and second queue are saved
+        // as products 2k and 2k + 1 of the cell state.
+        static constexpr std::size_t kMaxInputDepth = GameManagerConfig::kConveyorBufferSize / 2;
+
+        CombinerCell(CellPosition topLeft, Direction direction, std::size_t inputDepth = 1)
+            : ForegroundCell(topLeft), direction_{direction}, inputDepth_{inputDepth}, firstSlotProducts_{}, secondSlotProducts_{}
+        {
+            assert(inputDepth >= 1 && inputDepth <= kMaxInputDepth);
+        }
 
         Direction GetDirection() const { return direction_; }
 
-        int GetFirstSlotProduct() const { return firstSlotProduct_; }
+        std::size_t GetInputDepth() const { return inputDepth_; }
+
+        int GetFirstSlotProduct() const { return firstSlotProducts_[0]; }
 
-        int GetSecondSlotProduct() const { return secondSlotProduct_; }
+        int GetSecondSlotProduct() const { return secondSlotProducts_[0]; }
+
+        const CombinerStats &GetStats() const { return stats_; }
 
         void Accept(const CellVisitor *visitor) const override
         {
@@ -306,56 +458,120 @@ namespace Feis
 
         std::size_t GetCapacity(CellPosition cellPosition) const override
         {
-            if (IsMainCell(cellPosition))
-            {
-                if (firstSlotProduct_ == 0)
-                {
-                    return GameManagerConfig::kConveyorBufferSize;
-                }
-                return 0;
-            }
+            const Slot &slot = IsMainCell(cellPosition) ? firstSlotProducts_ : secondSlotProducts_;
 
-            if (secondSlotProduct_ == 0)
+            if (slot[inputDepth_ - 1] == 0)
             {
                 return GameManagerConfig::kConveyorBufferSize;
             }
             return 0;
         }
 
+        std::optional<Direction> GetOutputDirection(CellPosition cellPosition) const override
+        {
+            if (!IsMainCell(cellPosition))
+                return std::nullopt;
+            return direction_;
+        }
+
+        bool HasBufferedInput() const override
+        {
+            return true;
+        }
+
         void ReceiveProduct(CellPosition cellPosition, int number) override
         {
             assert(number != 0);
 
-            if (IsMainCell(cellPosition))
+            Slot &slot = IsMainCell(cellPosition) ? firstSlotProducts_ : secondSlotProducts_;
+            std::size_t count = GetCount(slot);
+            assert(count < inputDepth_);
+            slot[count] = number;
+        }
+
+        void UpdatePassOne(CellPosition cellPosition, GameBoard &board) override
+        {
+            if (!IsMainCell(cellPosition))
+                return;
+
+            std::size_t firstCount = GetCount(firstSlotProducts_);
+            std::size_t secondCount = GetCount(secondSlotProducts_);
+
+            stats_.heldProductTicks += firstCount + secondCount;
+            stats_.firstSlotFullTicks += firstCount == inputDepth_;
+            stats_.secondSlotFullTicks += secondCount == inputDepth_;
+
+            if (firstCount == 0 || secondCount == 0)
             {
-                firstSlotProduct_ = number;
+                stats_.idleTicks += firstCount == 0 && secondCount == 0;
+                stats_.waitingForFirstTicks += firstCount == 0 && secondCount != 0;
+                stats_.waitingForSecondTicks += firstCount != 0 && secondCount == 0;
+                return;
+            }
+
+            if (GetNeighborCapacity(board, cellPosition, direction_) >= 3)
+            {
+                SendProduct(board, cellPosition, direction_, firstSlotProducts_[0] + secondSlotProducts_[0]);
+                PopFront(firstSlotProducts_);
+                PopFront(secondSlotProducts_);
+                ++stats_.combinedCount;
             }
             else
             {
-                secondSlotProduct_ = number;
+                ++stats_.outletBlockedTicks;
             }
         }
 
-        void UpdatePassOne(CellPosition cellPosition, GameBoard &board) override
+        CellState GetState() const override
         {
-            if (!IsMainCell(cellPosition))
-                return;
+            CellState state{};
+            for (std::size_t k = 0; k < inputDepth_; ++k)
+            {
+                state.products[2 * k] = firstSlotProducts_[k];
+                state.products[2 * k + 1] = secondSlotProducts_[k];
+            }
+            return state;
+        }
 
-            if (firstSlotProduct_ != 0 && secondSlotProduct_ != 0)
+        void SetState(const CellState &state) override
+        {
+            for (std::size_t k = 0; k < inputDepth_; ++k)
             {
-                if (GetNeighborCapacity(board, cellPosition, direction_) >= 3)
-                {
-                    SendProduct(board, cellPosition, direction_, firstSlotProduct_ + secondSlotProduct_);
-                    firstSlotProduct_ = 0;
-                    secondSlotProduct_ = 0;
-                }
+                firstSlotProducts_[k] = state.products[2 * k];
+                secondSlotProducts_[k] = state.products[2 * k + 1];
             }
         }
 
+        std::shared_ptr<ForegroundCell> Clone(IGameManager *gameManager) const override
+        {
+            return std::make_shared<CombinerCell>(*this);
+        }
+
     private:
+        // Products in arrival order, then zeros.
+        using Slot = std::array<int, kMaxInputDepth>;
+
+        std::size_t GetCount(const Slot &slot) const
+        {
+            std::size_t count = 0;
+            while (count < inputDepth_ && slot[count] != 0)
+            {
+                ++count;
+            }
+            return count;
+        }
+
+        void PopFront(Slot &slot)
+        {
+            std::copy(slot.begin() + 1, slot.begin() + inputDepth_, slot.begin());
+            slot[inputDepth_ - 1] = 0;
+        }
+
         Direction direction_;
-        int firstSlotProduct_;
-        int secondSlotProduct_;
+        std::size_t inputDepth_;
+        Slot firstSlotProducts_;
+        Slot secondSlotProducts_;
+        CombinerStats stats_;
     };
 
     class WallCell : public ForegroundCell
@@ -371,6 +587,10 @@ namespace Feis
         {
             visitor->Visit(this);
         }
+        std::shared_ptr<ForegroundCell> Clone(IGameManager *gameManager) const override
+        {
+            return std::make_shared<WallCell>(*this);
+        }
     };
 
     class CollectionCenterCell : public ForegroundCell
@@ -378,9 +598,12 @@ namespace Feis
     public:
         CollectionCenterCell(
             CellPosition topLeft,
-            IGameManager *gameManager)
+            IGameManager *gameManager,
+            std::size_t owner = 0)
             : ForegroundCell(topLeft),
-              gameManager_{gameManager} {}
+              gameManager_{gameManager}, owner_{owner} {}
+
+        std::size_t GetOwner() const { return owner_; }
 
         void Accept(const CellVisitor *visitor) const override
         {
@@ -405,16 +628,21 @@ namespace Feis
 
             if (number)
             {
-                gameManager_->OnProductReceived(number);
+                gameManager_->OnProductReceived(number, owner_);
             }
         }
         int GetScores() const
         {
-            return gameManager_->GetScores();
+            return gameManager_->GetPlayerScores(owner_);
+        }
+        std::shared_ptr<ForegroundCell> Clone(IGameManager *gameManager) const override
+        {
+            return std::make_shared<CollectionCenterCell>(topLeftCellPosition_, gameManager, owner_);
         }
 
     private:
         IGameManager *gameManager_;
+        std::size_t owner_;
     };
 
     class LayeredCell
@@ -497,7 +725,45 @@ namespace Feis
             {
                 for (std::size_t j = 0; j < cell->GetWidth(); ++j)
                 {
-                    layeredCells_[topLeft.row + i][topLeft.col + j].SetForegrund(cell);
+                    SetForeground({topLeft.row + static_cast<int>(i), topLeft.col + static_cast<int>(j)}, cell);
+                }
+            }
+            return true;
+        }
+
+        // Builds all the cells or none: every footprint is checked against the board and against the
+        // footprints before it, then all are inserted.
+        bool BuildAll(const std::vector<std::shared_ptr<ForegroundCell>> &cells)
+        {
+            std::bitset<GameManagerConfig::kBoardHeight * GameManagerConfig::kBoardWidth> claimed;
+
+            for (const auto &cell : cells)
+            {
+                if (!CanBuild(cell))
+                    return false;
+
+                CellPosition topLeft = cell->GetTopLeftCellPosition();
+                for (std::size_t i = 0; i < cell->GetHeight(); ++i)
+                {
+                    for (std::size_t j = 0; j < cell->GetWidth(); ++j)
+                    {
+                        std::size_t index = (topLeft.row + i) * GameManagerConfig::kBoardWidth + topLeft.col + j;
+                        if (claimed[index])
+                            return false;
+                        claimed.set(index);
+                    }
+                }
+            }
+
+            for (const auto &cell : cells)
+            {
+                CellPosition topLeft = cell->GetTopLeftCellPosition();
+                for (std::size_t i = 0; i < cell->GetHeight(); ++i)
+                {
+                    for (std::size_t j = 0; j < cell->GetWidth(); ++j)
+                    {
+                        SetForeground({topLeft.row + static_cast<int>(i), topLeft.col + static_cast<int>(j)}, cell);
+                    }
                 }
             }
             return true;
@@ -517,7 +783,7 @@ namespace Feis
                     {
                         for (std::size_t j = 0; j < foreground->GetWidth(); ++j)
                         {
-                            layeredCells_[topLeftCellPosition.row + i][topLeftCellPosition.col + j].SetForegrund(nullptr);
+                            SetForeground({topLeftCellPosition.row + static_cast<int>(i), topLeftCellPosition.col + static_cast<int>(j)}, nullptr);
                         }
                     }
                 }
@@ -527,9 +793,99 @@ namespace Feis
         void SetBackground(CellPosition cellPosition, std::shared_ptr<IBackgroundCell> value)
         {
             layeredCells_[cellPosition.row][cellPosition.col].SetBackground(value);
+            ++version_;
+        }
+
+        // Changes whenever a cell gets a different background or foreground entity; entity state
+        // such as conveyor products does not count.
+        std::size_t GetVersion() const { return version_; }
+
+        // Backgrounds are immutable and shared; every foreground entity is cloned once, on its
+        // top-left cell, which row-major order always reaches first. The journal is not copied; the
+        // version is, so a copy reports the same version as its source.
+        void CopyFrom(const GameBoard &other, IGameManager *gameManager)
+        {
+            for (int row = 0; row < GameManagerConfig::kBoardHeight; ++row)
+            {
+                for (int col = 0; col < GameManagerConfig::kBoardWidth; ++col)
+                {
+                    const LayeredCell &otherLayeredCell = other.layeredCells_[row][col];
+                    LayeredCell &layeredCell = layeredCells_[row][col];
+
+                    layeredCell.SetBackground(otherLayeredCell.GetBackground());
+
+                    auto foreground = otherLayeredCell.GetForeground();
+                    if (foreground == nullptr)
+                    {
+                        layeredCell.SetForegrund(nullptr);
+                    }
+                    else if (foreground->GetTopLeftCellPosition() == CellPosition{row, col})
+                    {
+                        layeredCell.SetForegrund(foreground->Clone(gameManager));
+                    }
+                    else
+                    {
+                        CellPosition topLeft = foreground->GetTopLeftCellPosition();
+                        layeredCell.SetForegrund(layeredCells_[topLeft.row][topLeft.col].GetForeground());
+                    }
+                }
+            }
+            version_ = other.version_;
+            dirtyTrackingEnabled_ = other.dirtyTrackingEnabled_;
+            dirtyCells_ = other.dirtyCells_;
+        }
+
+        // Runs task(0) ... task(count - 1), possibly concurrently, and returns once all have finished.
+        using ParallelFor = std::function<void(std::size_t count, const std::function<void(std::size_t)> &task)>;
+
+        // Splits Update into stripeCount row stripes run through parallelFor. Entities only touch the
+        // entity they face and their own other cells, so the board falls apart into chains that share
+        // no state except the score; a stripe updates the chains lying wholly inside it, in row-major
+        // order, and the chains crossing a stripe boundary are updated afterwards, in row-major order
+        // too. Each chain thus sees the order the serial passes give it, and the result is identical.
+        // Updates that record states for the journal or dirty tracking stay serial.
+        void EnableParallelUpdate(ParallelFor parallelFor, std::size_t stripeCount)
+        {
+            parallelFor_ = std::move(parallelFor);
+            stripeCount_ = std::clamp<std::size_t>(stripeCount, 1, GameManagerConfig::kBoardHeight);
+            hasStripes_ = false;
+        }
+
+        // Hash of every foreground entity and its state. Equal boards hash equally within one build.
+        std::size_t GetStateHash() const
+        {
+            std::size_t hash = 0;
+            for (int row = 0; row < GameManagerConfig::kBoardHeight; ++row)
+            {
+                for (int col = 0; col < GameManagerConfig::kBoardWidth; ++col)
+                {
+                    const ForegroundCell *foreground = layeredCells_[row][col].GetForeground().get();
+                    if (foreground == nullptr)
+                    {
+                        HashCombine(hash, 0);
+                        continue;
+                    }
+
+                    HashForegroundCell(hash, typeid(*foreground).hash_code(), foreground->GetTopLeftCellPosition(),
+                                       foreground->GetOutputDirection({row, col}), foreground->GetState());
+                }
+            }
+            return hash;
         }
 
         void Update()
+        {
+            if (parallelFor_ && stripeCount_ > 1 && !IsRecordingState())
+            {
+                UpdateInStripes();
+            }
+            else
+            {
+                UpdateSerially();
+            }
+        }
+
+        void UpdateSerially()
         {
             for (int row = 0; row < GameManagerConfig::kBoardHeight; ++row)
             {
@@ -539,7 +895,16 @@ namespace Feis
                     auto foreground = layeredCell.GetForeground();
                     if (foreground != nullptr)
                     {
-                        foreground->UpdatePassOne({row, col}, *this);
+                        if (IsRecordingState())
+                        {
+                            auto state = foreground->GetState();
+                            foreground->UpdatePassOne({row, col}, *this);
+                            RecordState(foreground, state);
+                        }
+                        else
+                        {
+                            foreground->UpdatePassOne({row, col}, *this);
+                        }
                     }
                 }
             }
@@ -551,97 +916,441 @@ namespace Feis
                     auto foreground = layeredCell.GetForeground();
                     if (foreground != nullptr)
                     {
-                        foreground->UpdatePassTwo({row, col}, *this);
+                        if (IsRecordingState())
+                        {
+                            auto state = foreground->GetState();
+                            foreground->UpdatePassTwo({row, col}, *this);
+                            RecordState(foreground, state);
+                        }
+                        else
+                        {
+                            foreground->UpdatePassTwo({row, col}, *this);
+                        }
                     }
                 }
             }
         }
 
-    private:
-        std::array<std::array<LayeredCell, GameManagerConfig::kBoardWidth>, GameManagerConfig::kBoardHeight> layeredCells_;
-    };
-
-    bool IsWithinBoard(CellPosition cellPosition)
-    {
-        return cellPosition.row >= 0 && cellPosition.row < GameManagerConfig::kBoardHeight &&
-               cellPosition.col >= 0 && cellPosition.col < GameManagerConfig::kBoardWidth;
-    }
-
-    void SendProduct(GameBoard &board, CellPosition cellPosition, Direction direction, int product)
-    {
-        CellPosition targetCellPosition = GetNeighborCellPosition(cellPosition, direction);
-
-        if (!IsWithinBoard(targetCellPosition))
-            return;
-
-        auto foregroundCell = board.GetLayeredCell(targetCellPosition).GetForeground();
+        // The undo journal records, per tick, every foreground slot that was replaced and the previous
+        // state of every cell whose slots or timers changed, so rolling back costs time proportional
+        // to what happened rather than to the board size.
+        bool IsJournalEnabled() const { return journalEnabled_; }
 
-        if (foregroundCell)
+        void EnableJournal(bool enabled)
         {
-            foregroundCell->ReceiveProduct(targetCellPosition, product);
+            journalEnabled_ = enabled;
+            journalTickCount_ = 0;
+            journal_.clear();
         }
-    }
-
-    std::size_t GetNeighborCapacity(const GameBoard &board, CellPosition cellPosition, Direction direction)
-    {
-        CellPosition neighborCellPosition = GetNeighborCellPosition(cellPosition, direction);
 
-        if (!IsWithinBoard(neighborCellPosition))
-            return 0;
+        void BeginJournalTick(std::size_t elapsedTime, int scores)
+        {
+            JournalEntry entry{};
+            entry.kind = JournalEntry::Kind::kTick;
+            entry.elapsedTime = elapsedTime;
+            entry.scores = scores;
+            journal_.push_back(entry);
+            ++journalTickCount_;
+        }
 
-        auto foregroundCell = board.GetLayeredCell(neighborCellPosition).GetForeground();
+        std::size_t GetJournalTickCount() const
+        {
+            return journalTickCount_;
+        }
 
-        if (foregroundCell)
+        // Forgets all but the last keepTicks journaled ticks. A tick's entries follow its marker, so
+        // the oldest tick ends where the next marker starts.
+        void TrimJournal(std::size_t keepTicks)
         {
-            return foregroundCell->GetCapacity(neighborCellPosition);
+            while (journalTickCount_ > keepTicks)
+            {
+                if (journal_.front().kind == JournalEntry::Kind::kTick)
+                {
+                    --journalTickCount_;
+                }
+                journal_.pop_front();
+
+                while (!journal_.empty() && journal_.front().kind != JournalEntry::Kind::kTick)
+                {
+                    journal_.pop_front();
+                }
+            }
         }
-        return 0;
-    }
 
-    class NumberCell : public IBackgroundCell
-    {
-    public:
-        NumberCell(int number) : number_(number) {}
+        // Dirty tracking marks every cell whose foreground entity was replaced or whose conveyor or
+        // combiner slots changed since the last ClearDirtyCells; clearing it every tick gives the
+        // cells that changed in that tick. Timers are ignored, as nothing draws them.
+        using DirtyCells = std::bitset<GameManagerConfig::kBoardHeight * GameManagerConfig::kBoardWidth>;
 
-        int GetNumber() const
+        bool IsDirtyTrackingEnabled() const { return dirtyTrackingEnabled_; }
+
+        void EnableDirtyTracking(bool enabled)
         {
-            return number_;
+            dirtyTrackingEnabled_ = enabled;
+            dirtyCells_.set();
         }
 
-        bool CanBuild() const override
+        const DirtyCells &GetDirtyCells() const { return dirtyCells_; }
+
+        bool IsCellDirty(CellPosition cellPosition) const
         {
-            return true;
+            return !dirtyTrackingEnabled_ || dirtyCells_[cellPosition.row * GameManagerConfig::kBoardWidth + cellPosition.col];
         }
 
-        void Accept(const CellVisitor *visitor) const override
+        void MarkDirty(CellPosition cellPosition)
         {
-            visitor->Visit(this);
+            if (dirtyTrackingEnabled_)
+            {
+                dirtyCells_.set(cellPosition.row * GameManagerConfig::kBoardWidth + cellPosition.col);
+            }
         }
 
-    private:
-        int number_;
-    };
+        void ClearDirtyCells() { dirtyCells_.reset(); }
 
-    class BackgroundCellFactory
-    {
-    public:
-        BackgroundCellFactory(unsigned int seed) : gen_(seed) {}
+        // Whether update passes have to capture cell states for RecordState.
+        bool IsRecordingState() const { return journalEnabled_ || dirtyTrackingEnabled_; }
 
-        std::shared_ptr<IBackgroundCell> Create()
+        void RecordState(const std::shared_ptr<ForegroundCell> &cell, const ForegroundCell::CellState &previousState)
         {
-            int val = gen_() % 30;
+            if (!IsRecordingState())
+                return;
 
-            std::set<int> numbers = {1, 2, 3, 5, 7, 11};
+            ForegroundCell::CellState state = cell->GetState();
 
-            if (numbers.count(val))
-            {
-                return std::make_shared<NumberCell>(val);
-            }
-            else
+            if (dirtyTrackingEnabled_ && state.products != previousState.products)
             {
-                return nullptr;
+                MarkDirty(*cell);
             }
-        }
+
+            if (!journalEnabled_ || state == previousState)
+                return;
+
+            JournalEntry entry{};
+            entry.kind = JournalEntry::Kind::kState;
+            entry.cell = cell;
+            entry.state = previousState;
+            journal_.push_back(entry);
+        }
+
+        // Undoes the last `ticks` journaled ticks and reports the elapsed time and scores recorded
+        // at the start of the oldest one. Returns false if the journal holds fewer ticks.
+        bool RollbackJournal(std::size_t ticks, std::size_t &elapsedTime, int &scores)
+        {
+            if (ticks > journalTickCount_)
+                return false;
+
+            while (ticks > 0)
+            {
+                JournalEntry &entry = journal_.back();
+                switch (entry.kind)
+                {
+                case JournalEntry::Kind::kTick:
+                    elapsedTime = entry.elapsedTime;
+                    scores = entry.scores;
+                    --journalTickCount_;
+                    --ticks;
+                    break;
+                case JournalEntry::Kind::kForeground:
+                    layeredCells_[entry.cellPosition.row][entry.cellPosition.col].SetForegrund(entry.cell);
+                    MarkDirty(entry.cellPosition);
+                    ++version_;
+                    break;
+                case JournalEntry::Kind::kState:
+                    entry.cell->SetState(entry.state);
+                    MarkDirty(*entry.cell);
+                    break;
+                }
+                journal_.pop_back();
+            }
+            return true;
+        }
+
+    private:
+        struct JournalEntry
+        {
+            enum class Kind
+            {
+                kTick,
+                kForeground,
+                kState
+            };
+
+            Kind kind;
+            CellPosition cellPosition;
+            std::shared_ptr<ForegroundCell> cell;
+            ForegroundCell::CellState state;
+            std::size_t elapsedTime;
+            int scores;
+        };
+
+        void SetForeground(CellPosition cellPosition, const std::shared_ptr<ForegroundCell> &value)
+        {
+            auto &layeredCell = layeredCells_[cellPosition.row][cellPosition.col];
+
+            if (journalEnabled_)
+            {
+                JournalEntry entry{};
+                entry.kind = JournalEntry::Kind::kForeground;
+                entry.cellPosition = cellPosition;
+                entry.cell = layeredCell.GetForeground();
+                journal_.push_back(entry);
+            }
+            layeredCell.SetForegrund(value);
+            MarkDirty(cellPosition);
+            ++version_;
+        }
+
+        int GetStripe(int row) const
+        {
+            return static_cast<int>(row * stripeCount_ / GameManagerConfig::kBoardHeight);
+        }
+
+        // Groups cells into chains with a union-find over "faces a buffered entity" and "belongs to
+        // the same entity", then files each chain's cells under its stripe or the crossing list.
+        void BuildStripes()
+        {
+            constexpr int kCellCount = GameManagerConfig::kBoardHeight * GameManagerConfig::kBoardWidth;
+
+            auto indexOf = [](CellPosition cellPosition)
+            { return cellPosition.row * GameManagerConfig::kBoardWidth + cellPosition.col; };
+
+            std::vector<int> parents(kCellCount);
+            std::iota(parents.begin(), parents.end(), 0);
+
+            auto find = [&parents](int k)
+            {
+                while (parents[k] != k)
+                {
+                    parents[k] = parents[parents[k]];
+                    k = parents[k];
+                }
+                return k;
+            };
+
+            for (int row = 0; row < GameManagerConfig::kBoardHeight; ++row)
+            {
+                for (int col = 0; col < GameManagerConfig::kBoardWidth; ++col)
+                {
+                    auto foreground = layeredCells_[row][col].GetForeground();
+                    if (foreground == nullptr)
+                        continue;
+
+                    parents[find(indexOf({row, col}))] = find(indexOf(foreground->GetTopLeftCellPosition()));
+
+                    auto direction = foreground->GetOutputDirection({row, col});
+                    if (!direction)
+                        continue;
+
+                    CellPosition target = GetNeighborCellPosition({row, col}, *direction);
+                    if (target.row < 0 || target.row >= GameManagerConfig::kBoardHeight ||
+                        target.col < 0 || target.col >= GameManagerConfig::kBoardWidth)
+                        continue;
+
+                    auto targetForeground = layeredCells_[target.row][target.col].GetForeground();
+                    if (targetForeground && targetForeground->HasBufferedInput())
+                    {
+                        parents[find(indexOf({row, col}))] = find(indexOf(target));
+                    }
+                }
+            }
+
+            std::vector<int> firstStripes(kCellCount, -1);
+            std::vector<int> lastStripes(kCellCount, -1);
+            for (int row = 0; row < GameManagerConfig::kBoardHeight; ++row)
+            {
+                for (int col = 0; col < GameManagerConfig::kBoardWidth; ++col)
+                {
+                    if (layeredCells_[row][col].GetForeground() == nullptr)
+                        continue;
+
+                    int root = find(indexOf({row, col}));
+                    if (firstStripes[root] < 0)
+                    {
+                        firstStripes[root] = GetStripe(row);
+                    }
+                    lastStripes[root] = GetStripe(row);
+                }
+            }
+
+            stripeCells_.assign(stripeCount_, {});
+            crossingCells_.clear();
+            for (int row = 0; row < GameManagerConfig::kBoardHeight; ++row)
+            {
+                for (int col = 0; col < GameManagerConfig::kBoardWidth; ++col)
+                {
+                    if (layeredCells_[row][col].GetForeground() == nullptr)
+                        continue;
+
+                    int root = find(indexOf({row, col}));
+                    if (firstStripes[root] == lastStripes[root])
+                    {
+                        stripeCells_[firstStripes[root]].push_back({row, col});
+                    }
+                    else
+                    {
+                        crossingCells_.push_back({row, col});
+                    }
+                }
+            }
+
+            stripesVersion_ = version_;
+            hasStripes_ = true;
+        }
+
+        // Pass two only moves products inside a conveyor, so stripes need no merge there.
+        void UpdateInStripes()
+        {
+            if (!hasStripes_ || stripesVersion_ != version_)
+            {
+                BuildStripes();
+            }
+
+            parallelFor_(stripeCount_, [this](std::size_t stripe)
+                         {
+                             for (CellPosition cellPosition : stripeCells_[stripe])
+                             {
+                                 layeredCells_[cellPosition.row][cellPosition.col].GetForeground()->UpdatePassOne(cellPosition, *this);
+                             } });
+
+            for (CellPosition cellPosition : crossingCells_)
+            {
+                layeredCells_[cellPosition.row][cellPosition.col].GetForeground()->UpdatePassOne(cellPosition, *this);
+            }
+
+            parallelFor_(stripeCount_, [this](std::size_t stripe)
+                         {
+                             int firstRow = static_cast<int>((stripe * GameManagerConfig::kBoardHeight + stripeCount_ - 1) / stripeCount_);
+                             int lastRow = static_cast<int>(((stripe + 1) * GameManagerConfig::kBoardHeight + stripeCount_ - 1) / stripeCount_);
+                             for (int row = firstRow; row < lastRow; ++row)
+                             {
+                                 for (int col = 0; col < GameManagerConfig::kBoardWidth; ++col)
+                                 {
+                                     if (auto foreground = layeredCells_[row][col].GetForeground())
+                                     {
+                                         foreground->UpdatePassTwo({row, col}, *this);
+                                     }
+                                 }
+                             } });
+        }
+
+        void MarkDirty(const ForegroundCell &cell)
+        {
+            CellPosition topLeft = cell.GetTopLeftCellPosition();
+
+            for (std::size_t i = 0; i < cell.GetHeight(); ++i)
+            {
+                for (std::size_t j = 0; j < cell.GetWidth(); ++j)
+                {
+                    MarkDirty({topLeft.row + static_cast<int>(i), topLeft.col + static_cast<int>(j)});
+                }
+            }
+        }
+
+        std::array<std::array<LayeredCell, GameManagerConfig::kBoardWidth>, GameManagerConfig::kBoardHeight> layeredCells_;
+        std::size_t version_ = 0;
+        bool dirtyTrackingEnabled_ = false;
+        DirtyCells dirtyCells_;
+        bool journalEnabled_ = false;
+        std::size_t journalTickCount_ = 0;
+        std::deque<JournalEntry> journal_;
+        ParallelFor parallelFor_;
+        std::size_t stripeCount_ = 1;
+        bool hasStripes_ = false;
+        std::size_t stripesVersion_ = 0;
+        std::vector<std::vector<CellPosition>> stripeCells_;
+        std::vector<CellPosition> crossingCells_;
+    };
+
+    bool IsWithinBoard(CellPosition cellPosition)
+    {
+        return cellPosition.row >= 0 && cellPosition.row < GameManagerConfig::kBoardHeight &&
+               cellPosition.col >= 0 && cellPosition.col < GameManagerConfig::kBoardWidth;
+    }
+
+    void SendProduct(GameBoard &board, CellPosition cellPosition, Direction direction, int product)
+    {
+        CellPosition targetCellPosition = GetNeighborCellPosition(cellPosition, direction);
+
+        if (!IsWithinBoard(targetCellPosition))
+            return;
+
+        auto foregroundCell = board.GetLayeredCell(targetCellPosition).GetForeground();
+
+        if (foregroundCell)
+        {
+            if (board.IsRecordingState())
+            {
+                auto state = foregroundCell->GetState();
+                foregroundCell->ReceiveProduct(targetCellPosition, product);
+                board.RecordState(foregroundCell, state);
+            }
+            else
+            {
+                foregroundCell->ReceiveProduct(targetCellPosition, product);
+            }
+        }
+    }
+
+    std::size_t GetNeighborCapacity(const GameBoard &board, CellPosition cellPosition, Direction direction)
+    {
+        CellPosition neighborCellPosition = GetNeighborCellPosition(cellPosition, direction);
+
+        if (!IsWithinBoard(neighborCellPosition))
+            return 0;
+
+        auto foregroundCell = board.GetLayeredCell(neighborCellPosition).GetForeground();
+
+        if (foregroundCell)
+        {
+            return foregroundCell->GetCapacity(neighborCellPosition);
+        }
+        return 0;
+    }
+
+    class NumberCell : public IBackgroundCell
+    {
+    public:
+        NumberCell(int number) : number_(number) {}
+
+        int GetNumber() const
+        {
+            return number_;
+        }
+
+        bool CanBuild() const override
+        {
+            return true;
+        }
+
+        void Accept(const CellVisitor *visitor) const override
+        {
+            visitor->Visit(this);
+        }
+
+    private:
+        int number_;
+    };
+
+    class BackgroundCellFactory
+    {
+    public:
+        BackgroundCellFactory(unsigned int seed) : gen_(seed) {}
+
+        std::shared_ptr<IBackgroundCell> Create()
+        {
+            int val = gen_() % 30;
+
+            std::set<int> numbers = {1, 2, 3, 5, 7, 11};
+
+            if (numbers.count(val))
+            {
+                return std::make_shared<NumberCell>(val);
+            }
+            else
+            {
+                return nullptr;
+            }
+        }
 
     private:
         std::mt19937 gen_;
@@ -668,6 +1377,10 @@ namespace Feis
         {
             return 0;
         }
+        std::optional<Direction> GetOutputDirection(CellPosition cellPosition) const override
+        {
+            return direction_;
+        }
         void ReceiveProduct(CellPosition cellPosition, int number) override
         {
         }
@@ -688,6 +1401,23 @@ namespace Feis
             }
         }
 
+        CellState GetState() const override
+        {
+            CellState state{};
+            state.elapsedTime = elapsedTime_;
+            return state;
+        }
+
+        void SetState(const CellState &state) override
+        {
+            elapsedTime_ = state.elapsedTime;
+        }
+
+        std::shared_ptr<ForegroundCell> Clone(IGameManager *gameManager) const override
+        {
+            return std::make_shared<MiningMachineCell>(*this);
+        }
+
     private:
         Direction direction_;
         std::size_t elapsedTime_;
@@ -717,12 +1447,133 @@ namespace Feis
         CellPosition cellPosition;
     };
 
+    enum class BlueprintCellType
+    {
+        kMiningMachine,
+        kConveyor,
+        kCombiner,
+    };
+
+    // One entity of a blueprint; cellPosition is its top-left cell, as for the build actions.
+    struct BlueprintCell
+    {
+        BlueprintCellType type;
+        Direction direction;
+        CellPosition cellPosition;
+    };
+
+    // The entity a build action places; false for actions that build nothing.
+    bool ToBlueprintCell(const PlayerAction &action, BlueprintCell &blueprintCell)
+    {
+        switch (action.type)
+        {
+        case PlayerActionType::BuildLeftOutMiningMachine:
+            blueprintCell = {BlueprintCellType::kMiningMachine, Direction::kLeft, action.cellPosition};
+            return true;
+        case PlayerActionType::BuildTopOutMiningMachine:
+            blueprintCell = {BlueprintCellType::kMiningMachine, Direction::kTop, action.cellPosition};
+            return true;
+        case PlayerActionType::BuildRightOutMiningMachine:
+            blueprintCell = {BlueprintCellType::kMiningMachine, Direction::kRight, action.cellPosition};
+            return true;
+        case PlayerActionType::BuildBottomOutMiningMachine:
+            blueprintCell = {BlueprintCellType::kMiningMachine, Direction::kBottom, action.cellPosition};
+            return true;
+        case PlayerActionType::BuildLeftToRightConveyor:
+            blueprintCell = {BlueprintCellType::kConveyor, Direction::kRight, action.cellPosition};
+            return true;
+        case PlayerActionType::BuildTopToBottomConveyor:
+            blueprintCell = {BlueprintCellType::kConveyor, Direction::kBottom, action.cellPosition};
+            return true;
+        case PlayerActionType::BuildRightToLeftConveyor:
+            blueprintCell = {BlueprintCellType::kConveyor, Direction::kLeft, action.cellPosition};
+            return true;
+        case PlayerActionType::BuildBottomToTopConveyor:
+            blueprintCell = {BlueprintCellType::kConveyor, Direction::kTop, action.cellPosition};
+            return true;
+        case PlayerActionType::BuildTopOutCombiner:
+            blueprintCell = {BlueprintCellType::kCombiner, Direction::kTop, action.cellPosition};
+            return true;
+        case PlayerActionType::BuildRightOutCombiner:
+            blueprintCell = {BlueprintCellType::kCombiner, Direction::kRight, action.cellPosition};
+            return true;
+        case PlayerActionType::BuildBottomOutCombiner:
+            blueprintCell = {BlueprintCellType::kCombiner, Direction::kBottom, action.cellPosition};
+            return true;
+        case PlayerActionType::BuildLeftOutCombiner:
+            blueprintCell = {BlueprintCellType::kCombiner, Direction::kLeft, action.cellPosition};
+            return true;
+        default:
+            return false;
+        }
+    }
+
     class IGamePlayer
     {
     public:
         virtual PlayerAction GetNextAction(const IGameInfo &info) = 0;
     };
 
+    // Fixed-layout image of a whole game, meant to be written and mapped back as raw bytes. Every
+    // cell records its background number and, for the entity covering it, the kind, direction,
+    // top-left cell, state and, for a collection center, the owning player. No generator state is kept, since the seed is only used to lay out
+    // the board. Bump kVersion whenever a field changes layout or meaning.
+    struct SavedGame
+    {
+        static constexpr std::uint32_t kMagic = 0x56415346; // "FSAV" read as little-endian bytes
+        static constexpr std::uint32_t kVersion = 2;
+
+        enum Kind : std::uint8_t
+        {
+            kNone,
+            kWall,
+            kCollectionCenter,
+            kMiningMachine,
+            kConveyor,
+            kCombiner,
+        };
+
+        struct Cell
+        {
+            std::int32_t number;
+            std::int16_t topLeftRow;
+            std::int16_t topLeftCol;
+            std::uint8_t kind;
+            std::uint8_t direction;
+            std::uint8_t owner;
+            // Combiners only; 0 in images from before deeper slots means 1.
+            std::uint8_t inputDepth;
+            std::int32_t products[GameManagerConfig::kConveyorBufferSize];
+            std::uint32_t reserved2;
+            std::uint64_t elapsedTime;
+        };
+
+        std::uint32_t magic;
+        std::uint32_t version;
+        std::uint32_t width;
+        std::uint32_t height;
+        std::uint64_t elapsedTime;
+        std::uint64_t endTime;
+        std::int32_t commonDividor;
+        std::int32_t scores;
+        std::uint32_t playerCount;
+        std::int32_t playerScores[GameManagerConfig::kMaxPlayers];
+        // Bit 0 is set for sandbox games; bits 8 to 15 hold the combiner input depth they build
+        // with. 0 in images from before either was saved means a game outside the sandbox.
+        std::uint32_t sandbox;
+        Cell cells[GameManagerConfig::kBoardHeight][GameManagerConfig::kBoardWidth];
+
+        // Whether the image was written by this version for this board size.
+        bool IsCompatible() const
+        {
+            return magic == kMagic && version == kVersion &&
+                   width == GameManagerConfig::kBoardWidth && height == GameManagerConfig::kBoardHeight &&
+                   playerCount >= 1 && playerCount <= GameManagerConfig::kMaxPlayers;
+        }
+    };
+
+    static_assert(sizeof(SavedGame::Cell) == 64, "SavedGame::Cell must have no hidden padding");
+
     class GameManager : public IGameManager
     {
     public:
@@ -732,11 +1583,30 @@ namespace Feis
             static constexpr int kTop = GameManagerConfig::kBoardHeight / 2 - GameManagerConfig::kGoalSize / 2;
         };
 
+        // A collection center and the player its deliveries score for.
+        struct CollectionCenterPlacement
+        {
+            CellPosition topLeft;
+            std::size_t owner;
+        };
+
         GameManager(
             IGamePlayer *player,
             int commonDividor,
             unsigned int seed)
-            : elapsedTime_{}, endTime_{GameManagerConfig::kEndTime}, player_(player), board_(), commonDividor_{commonDividor}, scores_{}
+            : GameManager(std::vector<IGamePlayer *>{player}, commonDividor, seed,
+                          {{{CollectionCenterConfig::kTop, CollectionCenterConfig::kLeft}, 0}})
+        {
+        }
+
+        // A game for several players, each scoring with the collection centers it owns. Centers are
+        // placed before the walls, in the given order; one that does not fit is left out.
+        GameManager(
+            std::vector<IGamePlayer *> players,
+            int commonDividor,
+            unsigned int seed,
+            const std::vector<CollectionCenterPlacement> &collectionCenters)
+            : GameManager(std::move(players), commonDividor)
         {
             static_assert(GameManagerConfig::kBoardWidth % 2 == 0, "WIDTH must be even");
 
@@ -752,10 +1622,14 @@ namespace Feis
                 }
             };
 
-            auto collectionCenterTopLeftCellPosition =
-                CellPosition{CollectionCenterConfig::kTop, CollectionCenterConfig::kLeft};
-
-            board_.template Build<CollectionCenterCell>(collectionCenterTopLeftCellPosition, this);
+            for (const CollectionCenterPlacement &collectionCenter : collectionCenters)
+            {
+                assert(collectionCenter.owner < players_.size());
+                if (board_.template Build<CollectionCenterCell>(collectionCenter.topLeft, this, collectionCenter.owner))
+                {
+                    collectionCenters_.push_back(collectionCenter);
+                }
+            }
 
             std::mt19937 gen(seed);
 
@@ -771,15 +1645,248 @@ namespace Feis
             }
         }
 
+        // Independent copy of the current game with `player` in the first seat and any other seats
+        // empty. The copy shares nothing mutable with this game, so forks can be simulated
+        // concurrently.
+        std::unique_ptr<GameManager> Fork(IGamePlayer *player) const override
+        {
+            std::vector<IGamePlayer *> players(players_.size(), nullptr);
+            players[0] = player;
+
+            std::unique_ptr<GameManager> fork(new GameManager(std::move(players), commonDividor_));
+            fork->elapsedTime_ = elapsedTime_;
+            fork->endTime_ = endTime_;
+            fork->scores_ = scores_.load();
+            for (std::size_t k = 0; k < players_.size(); ++k)
+            {
+                fork->playerScores_[k] = playerScores_[k].load();
+            }
+            fork->sandbox_ = sandbox_;
+            fork->combinerInputDepth_ = combinerInputDepth_;
+            fork->collectionCenters_ = collectionCenters_;
+            fork->board_.CopyFrom(board_, fork.get());
+            return fork;
+        }
+
         bool IsGameOver() const override
         {
             return elapsedTime_ >= endTime_;
         }
 
+        // Longer or shorter games than the judged kEndTime.
+        void SetEndTime(std::size_t endTime)
+        {
+            endTime_ = endTime;
+        }
+
+        void Save(SavedGame &savedGame) const
+        {
+            class SaveVisitor : public CellVisitor
+            {
+            public:
+                SaveVisitor(SavedGame::Cell *cell) : cell_(cell) {}
+
+                void Visit(const CollectionCenterCell *cell) const override
+                {
+                    cell_->kind = SavedGame::kCollectionCenter;
+                    cell_->owner = static_cast<std::uint8_t>(cell->GetOwner());
+                }
+
+                void Visit(const MiningMachineCell *cell) const override
+                {
+                    cell_->kind = SavedGame::kMiningMachine;
+                    cell_->direction = static_cast<std::uint8_t>(cell->GetDirection());
+                }
+
+                void Visit(const ConveyorCell *cell) const override
+                {
+                    cell_->kind = SavedGame::kConveyor;
+                    cell_->direction = static_cast<std::uint8_t>(cell->GetDirection());
+                }
+
+                void Visit(const CombinerCell *cell) const override
+                {
+                    cell_->kind = SavedGame::kCombiner;
+                    cell_->direction = static_cast<std::uint8_t>(cell->GetDirection());
+                    cell_->inputDepth = static_cast<std::uint8_t>(cell->GetInputDepth());
+                }
+
+                void Visit(const WallCell *cell) const override { cell_->kind = SavedGame::kWall; }
+
+            private:
+                SavedGame::Cell *cell_;
+            };
+
+            savedGame = {};
+            savedGame.magic = SavedGame::kMagic;
+            savedGame.version = SavedGame::kVersion;
+            savedGame.width = GameManagerConfig::kBoardWidth;
+            savedGame.height = GameManagerConfig::kBoardHeight;
+            savedGame.elapsedTime = elapsedTime_;
+            savedGame.endTime = endTime_;
+            savedGame.commonDividor = commonDividor_;
+            savedGame.scores = scores_.load();
+            savedGame.playerCount = static_cast<std::uint32_t>(players_.size());
+            for (std::size_t k = 0; k < players_.size(); ++k)
+            {
+                savedGame.playerScores[k] = playerScores_[k].load();
+            }
+            savedGame.sandbox = sandbox_ ? 1 | static_cast<std::uint32_t>(combinerInputDepth_) << 8 : 0;
+
+            for (int row = 0; row < GameManagerConfig::kBoardHeight; ++row)
+            {
+                for (int col = 0; col < GameManagerConfig::kBoardWidth; ++col)
+                {
+                    const LayeredCell &layeredCell = board_.GetLayeredCell({row, col});
+                    SavedGame::Cell &cell = savedGame.cells[row][col];
+
+                    auto numberCell = dynamic_cast<const NumberCell *>(layeredCell.GetBackground().get());
+                    cell.number = numberCell ? numberCell->GetNumber() : 0;
+
+                    auto foreground = layeredCell.GetForeground();
+                    if (foreground == nullptr)
+                        continue;
+
+                    SaveVisitor visitor(&cell);
+                    foreground->Accept(&visitor);
+
+                    ForegroundCell::CellState state = foreground->GetState();
+                    cell.topLeftRow = static_cast<std::int16_t>(foreground->GetTopLeftCellPosition().row);
+                    cell.topLeftCol = static_cast<std::int16_t>(foreground->GetTopLeftCellPosition().col);
+                    std::copy(state.products.begin(), state.products.end(), cell.products);
+                    cell.elapsedTime = state.elapsedTime;
+                }
+            }
+        }
+
+        // The game a compatible image was saved from, with `player` in the first seat and any other
+        // seats empty; nullptr if the image is not compatible.
+        static std::unique_ptr<GameManager> Load(const SavedGame &savedGame, IGamePlayer *player)
+        {
+            std::vector<IGamePlayer *> players(savedGame.IsCompatible() ? savedGame.playerCount : 1, nullptr);
+            players[0] = player;
+            return Load(savedGame, std::move(players));
+        }
+
+        // As above with every seat filled; nullptr also if the number of players differs.
+        static std::unique_ptr<GameManager> Load(const SavedGame &savedGame, std::vector<IGamePlayer *> players)
+        {
+            if (!savedGame.IsCompatible() || players.size() != savedGame.playerCount)
+                return nullptr;
+
+            std::unique_ptr<GameManager> game(new GameManager(std::move(players), savedGame.commonDividor));
+            game->elapsedTime_ = savedGame.elapsedTime;
+            game->endTime_ = savedGame.endTime;
+            game->scores_ = savedGame.scores;
+            for (std::size_t k = 0; k < savedGame.playerCount; ++k)
+            {
+                game->playerScores_[k] = savedGame.playerScores[k];
+            }
+            if (savedGame.sandbox != 0)
+            {
+                game->EnableSandbox((savedGame.sandbox & 1) != 0);
+                if (!game->SetCombinerInputDepth(savedGame.sandbox >> 8))
+                    return nullptr;
+            }
+
+            for (int row = 0; row < GameManagerConfig::kBoardHeight; ++row)
+            {
+                for (int col = 0; col < GameManagerConfig::kBoardWidth; ++col)
+                {
+                    const SavedGame::Cell &cell = savedGame.cells[row][col];
+                    CellPosition cellPosition{row, col};
+
+                    if (cell.number != 0)
+                    {
+                        game->board_.SetBackground(cellPosition, std::make_shared<NumberCell>(cell.number));
+                    }
+
+                    // Multi-cell entities are built from their top-left cell, which comes first.
+                    if (cell.kind == SavedGame::kNone || CellPosition{cell.topLeftRow, cell.topLeftCol} != cellPosition)
+                        continue;
+
+                    // An entity that does not fit, e.g. one overlapping another, makes the image
+                    // unusable rather than loading as a different game.
+                    Direction direction = static_cast<Direction>(cell.direction & 3);
+                    bool built = false;
+                    switch (cell.kind)
+                    {
+                    case SavedGame::kWall:
+                        built = game->board_.template Build<WallCell>(cellPosition);
+                        break;
+                    case SavedGame::kCollectionCenter:
+                        if (cell.owner >= savedGame.playerCount)
+                            return nullptr;
+                        built = game->board_.template Build<CollectionCenterCell>(cellPosition, game.get(), cell.owner);
+                        if (built)
+                        {
+                            game->collectionCenters_.push_back({cellPosition, cell.owner});
+                        }
+                        break;
+                    case SavedGame::kMiningMachine:
+                        built = game->board_.template Build<MiningMachineCell>(cellPosition, direction);
+                        break;
+                    case SavedGame::kConveyor:
+                        built = game->board_.template Build<ConveyorCell>(cellPosition, direction);
+                        break;
+                    case SavedGame::kCombiner:
+                        if (cell.inputDepth > CombinerCell::kMaxInputDepth)
+                            return nullptr;
+                        built = game->board_.template Build<CombinerCell>(cellPosition, direction, std::max<std::size_t>(cell.inputDepth, 1));
+                        break;
+                    default:
+                        return nullptr;
+                    }
+                    if (!built)
+                        return nullptr;
+
+                    ForegroundCell::CellState state{};
+                    std::copy(std::begin(cell.products), std::end(cell.products), state.products.begin());
+                    state.elapsedTime = cell.elapsedTime;
+                    game->board_.GetLayeredCell(cellPosition).GetForeground()->SetState(state);
+                }
+            }
+            return game;
+        }
+
         int GetEndTime() const override { return endTime_; }
 
         int GetElapsedTime() const override { return elapsedTime_; }
 
+        std::size_t GetBoardVersion() const override { return board_.GetVersion(); }
+
+        bool IsCellDirty(CellPosition cellPosition) const override { return board_.IsCellDirty(cellPosition); }
+
+        // See GameBoard::EnableDirtyTracking. The collection center is marked whenever the score
+        // changes, since it displays it.
+        void EnableDirtyTracking(bool enabled)
+        {
+            board_.EnableDirtyTracking(enabled);
+        }
+
+        void ClearDirtyCells()
+        {
+            board_.ClearDirtyCells();
+        }
+
+        // See GameBoard::EnableParallelUpdate. Players of a multi-player game also decide their
+        // actions through parallelFor.
+        void EnableParallelUpdate(GameBoard::ParallelFor parallelFor, std::size_t stripeCount)
+        {
+            parallelFor_ = parallelFor;
+            board_.EnableParallelUpdate(std::move(parallelFor), stripeCount);
+        }
+
+        // Hash of the elapsed time, the scores and the board state; two games in the same state
+        // hash equally, so it is cheap to compare engines tick by tick.
+        std::size_t GetStateHash() const
+        {
+            std::size_t hash = board_.GetStateHash();
+            HashCombine(hash, elapsedTime_);
+            HashCombine(hash, scores_.load());
+            return hash;
+        }
+
         std::string GetLevelInfo() const override
         {
             return "(" + std::to_string(commonDividor_) + ")";
@@ -790,14 +1897,34 @@ namespace Feis
             return number % commonDividor_ == 0;
         }
 
-        void OnProductReceived(int number) override
+        void OnProductReceived(int number, std::size_t player) override
         {
             assert(number != 0);
 
-            if (number % commonDividor_ == 0)
+            bool scored = number % commonDividor_ == 0;
+            if (scored)
             {
-                AddScore();
+                AddScore(player);
             }
+
+            if (deliveryEventSink_)
+            {
+                deliveryEventSink_->OnDelivery({elapsedTime_, number, scored, player});
+            }
+        }
+
+        std::size_t GetPlayerCount() const { return players_.size(); }
+
+        int GetPlayerScores(std::size_t player) const override
+        {
+            return playerScores_[player];
+        }
+
+        // Games with a sink update serially, so that deliveries reach it from one thread in board
+        // order. Pass nullptr to detach it.
+        void SetDeliveryEventSink(IDeliveryEventSink *sink)
+        {
+            deliveryEventSink_ = sink;
         }
 
         int GetScores() const override
@@ -810,9 +1937,135 @@ namespace Feis
             return board_.GetLayeredCell(cellPosition);
         }
 
-        void AddScore()
+        // GetScores is the total over all players.
+        void AddScore(std::size_t player = 0)
         {
             scores_++;
+            playerScores_[player]++;
+            MarkCollectionCentersDirty();
+        }
+
+        // Sandbox games may stamp blueprints besides taking one action every third tick. Products
+        // are scored the same way either way.
+        bool IsSandbox() const { return sandbox_; }
+
+        void EnableSandbox(bool enabled)
+        {
+            sandbox_ = enabled;
+            if (!enabled)
+            {
+                combinerInputDepth_ = 1;
+            }
+        }
+
+        // Slot depth of the combiners a sandbox game builds from now on; see CombinerCell. Refused
+        // outside the sandbox, where combiners hold one product per slot as the rules say.
+        bool SetCombinerInputDepth(std::size_t inputDepth)
+        {
+            if (!sandbox_ || inputDepth < 1 || inputDepth > CombinerCell::kMaxInputDepth)
+                return false;
+
+            combinerInputDepth_ = inputDepth;
+            return true;
+        }
+
+        std::size_t GetCombinerInputDepth() const { return combinerInputDepth_; }
+
+        struct CombinerReport
+        {
+            CellPosition topLeft;
+            Direction direction;
+            std::size_t inputDepth;
+            CombinerStats stats;
+        };
+
+        // Stats of every combiner on the board, in row-major order of their top-left cells. Counts
+        // start when a combiner is built and are not saved.
+        std::vector<CombinerReport> GetCombinerReports() const
+        {
+            std::vector<CombinerReport> reports;
+            for (int row = 0; row < GameManagerConfig::kBoardHeight; ++row)
+            {
+                for (int col = 0; col < GameManagerConfig::kBoardWidth; ++col)
+                {
+                    auto combiner = dynamic_cast<const CombinerCell *>(board_.GetLayeredCell({row, col}).GetForeground().get());
+                    if (combiner == nullptr || combiner->GetTopLeftCellPosition() != CellPosition{row, col})
+                        continue;
+
+                    reports.push_back({{row, col}, combiner->GetDirection(), combiner->GetInputDepth(), combiner->GetStats()});
+                }
+            }
+            return reports;
+        }
+
+        // Builds a whole blueprint at once if this is a sandbox game and every entity fits, and
+        // builds nothing otherwise.
+        bool StampBlueprint(const std::vector<BlueprintCell> &blueprint)
+        {
+            if (!sandbox_)
+                return false;
+
+            std::vector<std::shared_ptr<ForegroundCell>> cells;
+            cells.reserve(blueprint.size());
+
+            for (const BlueprintCell &blueprintCell : blueprint)
+            {
+                switch (blueprintCell.type)
+                {
+                case BlueprintCellType::kMiningMachine:
+                    cells.push_back(std::make_shared<MiningMachineCell>(blueprintCell.cellPosition, blueprintCell.direction));
+                    break;
+                case BlueprintCellType::kConveyor:
+                    cells.push_back(std::make_shared<ConveyorCell>(blueprintCell.cellPosition, blueprintCell.direction));
+                    break;
+                case BlueprintCellType::kCombiner:
+                    cells.push_back(std::make_shared<CombinerCell>(blueprintCell.cellPosition, blueprintCell.direction, combinerInputDepth_));
+                    break;
+                }
+            }
+            return board_.BuildAll(cells);
+        }
+
+        // Player state is not part of the journal; a player that searches by undoing ticks must
+        // restore its own state.
+        void EnableUndo(bool enabled)
+        {
+            board_.EnableJournal(enabled);
+        }
+
+        std::size_t GetUndoDepth() const
+        {
+            return board_.GetJournalTickCount();
+        }
+
+        // Keeps at most `limit` ticks undoable, forgetting the oldest as new ones are played, so a
+        // search that does not undo every probe runs in bounded memory. 0 keeps every tick.
+        void SetUndoLimit(std::size_t limit)
+        {
+            undoLimit_ = limit;
+            if (undoLimit_ != 0)
+            {
+                board_.TrimJournal(undoLimit_);
+            }
+        }
+
+        // The journal keeps only the total score, so multi-player games cannot undo.
+        bool Undo(std::size_t ticks)
+        {
+            if (players_.size() > 1)
+                return false;
+
+            std::size_t elapsedTime = elapsedTime_;
+            int scores = scores_;
+
+            if (!board_.RollbackJournal(ticks, elapsedTime, scores))
+                return false;
+
+            elapsedTime_ = elapsedTime;
+            scores_ = scores;
+            playerScores_[0] = scores;
+            MarkCollectionCentersDirty();
+            return true;
         }
 
         void Update()
@@ -820,73 +2073,219 @@ namespace Feis
             if (elapsedTime_ >= endTime_)
                 return;
 
+            if (board_.IsJournalEnabled())
+            {
+                board_.BeginJournalTick(elapsedTime_, scores_);
+                if (undoLimit_ != 0)
+                {
+                    board_.TrimJournal(undoLimit_);
+                }
+            }
+
             ++elapsedTime_;
 
             if (elapsedTime_ % 3 == 0)
             {
-                PlayerAction playerAction = player_->GetNextAction(*this);
+                auto decide = [this](std::size_t player)
+                {
+                    actions_[player] = players_[player]
+                                           ? players_[player]->GetNextAction(*this)
+                                           : PlayerAction{PlayerActionType::None, {0, 0}};
+                };
 
-                switch (playerAction.type)
+                // Players only read the game while deciding, so they may decide concurrently.
+                if (parallelFor_ && players_.size() > 1)
                 {
-                case PlayerActionType::None:
-                    break;
-                case PlayerActionType::BuildLeftOutMiningMachine:
-                    board_.template Build<MiningMachineCell>(playerAction.cellPosition, Direction::kLeft);
-                    break;
-                case PlayerActionType::BuildTopOutMiningMachine:
-                    board_.template Build<MiningMachineCell>(playerAction.cellPosition, Direction::kTop);
-                    break;
-                case PlayerActionType::BuildRightOutMiningMachine:
-                    board_.template Build<MiningMachineCell>(playerAction.cellPosition, Direction::kRight);
-                    break;
-                case PlayerActionType::BuildBottomOutMiningMachine:
-                    board_.template Build<MiningMachineCell>(playerAction.cellPosition, Direction::kBottom);
-                    break;
-                case PlayerActionType::BuildLeftToRightConveyor:
-                    board_.template Build<ConveyorCell>(playerAction.cellPosition, Direction::kRight);
-                    break;
-                case PlayerActionType::BuildTopToBottomConveyor:
-                    board_.template Build<ConveyorCell>(playerAction.cellPosition, Direction::kBottom);
-                    break;
-                case PlayerActionType::BuildRightToLeftConveyor:
-                    board_.template Build<ConveyorCell>(playerAction.cellPosition, Direction::kLeft);
-                    break;
-                case PlayerActionType::BuildBottomToTopConveyor:
-                    board_.template Build<ConveyorCell>(playerAction.cellPosition, Direction::kTop);
-                    break;
-                case PlayerActionType::BuildTopOutCombiner:
-                    board_.template Build<CombinerCell>(playerAction.cellPosition, Direction::kTop);
-                    break;
-                case PlayerActionType::BuildRightOutCombiner:
-                    board_.template Build<CombinerCell>(playerAction.cellPosition, Direction::kRight);
-                    break;
-                case PlayerActionType::BuildBottomOutCombiner:
-                    board_.template Build<CombinerCell>(playerAction.cellPosition, Direction::kBottom);
-                    break;
-                case PlayerActionType::BuildLeftOutCombiner:
-                    board_.template Build<CombinerCell>(playerAction.cellPosition, Direction::kLeft);
-                    break;
-                case PlayerActionType::Clear:
-                    board_.Remove(playerAction.cellPosition);
-                    break;
+                    parallelFor_(players_.size(), decide);
+                }
+                else
+                {
+                    for (std::size_t player = 0; player < players_.size(); ++player)
+                    {
+                        decide(player);
+                    }
+                }
+
+                if (players_.size() == 1)
+                {
+                    ApplyAction(actions_[0]);
+                }
+                else
+                {
+                    ApplyActions();
                 }
             }
 
-            board_.Update();
+            if (deliveryEventSink_)
+            {
+                board_.UpdateSerially();
+            }
+            else
+            {
+                board_.Update();
+            }
         }
 
     private:
+        GameManager(std::vector<IGamePlayer *> players, int commonDividor)
+            : elapsedTime_{}, endTime_{GameManagerConfig::kEndTime}, players_(std::move(players)), actions_(players_.size()),
+              board_(), commonDividor_{commonDividor}, scores_{}, playerScores_{}
+        {
+            assert(!players_.empty() && players_.size() <= GameManagerConfig::kMaxPlayers);
+        }
+
+        void ApplyAction(const PlayerAction &playerAction)
+        {
+            switch (playerAction.type)
+            {
+            case PlayerActionType::None:
+                break;
+            case PlayerActionType::BuildLeftOutMiningMachine:
+                board_.template Build<MiningMachineCell>(playerAction.cellPosition, Direction::kLeft);
+                break;
+            case PlayerActionType::BuildTopOutMiningMachine:
+                board_.template Build<MiningMachineCell>(playerAction.cellPosition, Direction::kTop);
+                break;
+            case PlayerActionType::BuildRightOutMiningMachine:
+                board_.template Build<MiningMachineCell>(playerAction.cellPosition, Direction::kRight);
+                break;
+            case PlayerActionType::BuildBottomOutMiningMachine:
+                board_.template Build<MiningMachineCell>(playerAction.cellPosition, Direction::kBottom);
+                break;
+            case PlayerActionType::BuildLeftToRightConveyor:
+                board_.template Build<ConveyorCell>(playerAction.cellPosition, Direction::kRight);
+                break;
+            case PlayerActionType::BuildTopToBottomConveyor:
+                board_.template Build<ConveyorCell>(playerAction.cellPosition, Direction::kBottom);
+                break;
+            case PlayerActionType::BuildRightToLeftConveyor:
+                board_.template Build<ConveyorCell>(playerAction.cellPosition, Direction::kLeft);
+                break;
+            case PlayerActionType::BuildBottomToTopConveyor:
+                board_.template Build<ConveyorCell>(playerAction.cellPosition, Direction::kTop);
+                break;
+            case PlayerActionType::BuildTopOutCombiner:
+                board_.template Build<CombinerCell>(playerAction.cellPosition, Direction::kTop, combinerInputDepth_);
+                break;
+            case PlayerActionType::BuildRightOutCombiner:
+                board_.template Build<CombinerCell>(playerAction.cellPosition, Direction::kRight, combinerInputDepth_);
+                break;
+            case PlayerActionType::BuildBottomOutCombiner:
+                board_.template Build<CombinerCell>(playerAction.cellPosition, Direction::kBottom, combinerInputDepth_);
+                break;
+            case PlayerActionType::BuildLeftOutCombiner:
+                board_.template Build<CombinerCell>(playerAction.cellPosition, Direction::kLeft, combinerInputDepth_);
+                break;
+            case PlayerActionType::Clear:
+                board_.Remove(playerAction.cellPosition);
+                break;
+            }
+        }
+
+        // The on-board cells an action would build on or clear.
+        std::vector<CellPosition> GetActionFootprint(const PlayerAction &playerAction) const
+        {
+            std::vector<CellPosition> footprint;
+            CellPosition topLeft = playerAction.cellPosition;
+            int width = 1;
+            int height = 1;
+
+            BlueprintCell blueprintCell;
+            if (ToBlueprintCell(playerAction, blueprintCell))
+            {
+                if (blueprintCell.type == BlueprintCellType::kCombiner)
+                {
+                    bool horizontal = blueprintCell.direction == Direction::kTop || blueprintCell.direction == Direction::kBottom;
+                    width = horizontal ? 2 : 1;
+                    height = horizontal ? 1 : 2;
+                }
+            }
+            else if (playerAction.type == PlayerActionType::Clear && IsWithinBoard(topLeft))
+            {
+                if (auto foreground = board_.GetLayeredCell(topLeft).GetForeground())
+                {
+                    topLeft = foreground->GetTopLeftCellPosition();
+                    width = static_cast<int>(foreground->GetWidth());
+                    height = static_cast<int>(foreground->GetHeight());
+                }
+            }
+            else
+            {
+                return footprint;
+            }
+
+            for (int i = 0; i < height; ++i)
+            {
+                for (int j = 0; j < width; ++j)
+                {
+                    CellPosition cellPosition = topLeft + CellPosition{i, j};
+                    if (IsWithinBoard(cellPosition))
+                    {
+                        footprint.push_back(cellPosition);
+                    }
+                }
+            }
+            return footprint;
+        }
+
+        // Resolves one round of actions in a single pass: actions whose cells overlap cancel each
+        // other, whoever issued them, and the rest touch disjoint cells, so applying them in seat
+        // order gives the board any other order would.
+        void ApplyActions()
+        {
+            std::vector<std::vector<CellPosition>> footprints;
+            std::vector<std::uint8_t> claims(GameManagerConfig::kBoardHeight * GameManagerConfig::kBoardWidth);
+
+            for (const PlayerAction &playerAction : actions_)
+            {
+                footprints.push_back(GetActionFootprint(playerAction));
+                for (CellPosition cellPosition : footprints.back())
+                {
+                    ++claims[cellPosition.row * GameManagerConfig::kBoardWidth + cellPosition.col];
+                }
+            }
+
+            for (std::size_t player = 0; player < actions_.size(); ++player)
+            {
+                bool contested = std::any_of(
+                    footprints[player].begin(), footprints[player].end(), [&claims](CellPosition cellPosition)
+                    { return claims[cellPosition.row * GameManagerConfig::kBoardWidth + cellPosition.col] > 1; });
+
+                if (!contested)
+                {
+                    ApplyAction(actions_[player]);
+                }
+            }
+        }
+
+        void MarkCollectionCentersDirty()
+        {
+            for (const CollectionCenterPlacement &collectionCenter : collectionCenters_)
+            {
+                board_.MarkDirty(collectionCenter.topLeft);
+            }
+        }
+
         std::size_t elapsedTime_;
         std::size_t endTime_;
-        IGamePlayer *player_;
+        std::vector<IGamePlayer *> players_;
+        std::vector<PlayerAction> actions_;
+        GameBoard::ParallelFor parallelFor_;
+        std::vector<CollectionCenterPlacement> collectionCenters_;
         GameBoard board_;
         int commonDividor_;
-        int scores_;
+        // Atomic so that stripes updated in parallel can feed the collection center.
+        std::atomic<int> scores_;
+        std::array<std::atomic<int>, GameManagerConfig::kMaxPlayers> playerScores_;
+        bool sandbox_ = false;
+        std::size_t combinerInputDepth_ = 1;
+        std::size_t undoLimit_ = 0;
+        IDeliveryEventSink *deliveryEventSink_ = nullptr;
     };
 }
 #endif
 
-#ifndef USE_GUI
+#if !defined(USE_GUI) && !defined(USE_HEADLESS)
 void Test(int commonDividor, unsigned int seed);
 
 void Test1A() { Test(1, 20); }
@@ -0,0 +1,404 @@
+#ifndef REFERENCE_GAME_MANAGER_HPP
+#define REFERENCE_GAME_MANAGER_HPP
+#include <array>
+#include <memory>
+#include <queue>
+#include <typeinfo>
+#include <vector>
+#include "PDOGS.cpp"
+
+namespace Feis
+{
+    // The rules of GameManager for one scripted player, written out plainly for any TConfig: a grid
+    // of entities updated one cell at a time in the order GameBoard::UpdateSerially uses, with one
+    // product per combiner slot. It is meant to be obviously right rather than fast, so that engines
+    // of shapes GameManager is not built for have something to be compared with; at
+    // GameManagerConfig it is itself checked against GameManager. States hash as GameManager's do.
+    template <typename TConfig = GameManagerConfig>
+    class ReferenceGameManager
+    {
+    public:
+        ReferenceGameManager(int commonDividor, unsigned int seed, std::queue<PlayerAction> actions)
+            : elapsedTime_{}, endTime_{TConfig::kEndTime}, actions_(std::move(actions)), commonDividor_{commonDividor}, scores_{},
+              numbers_(TConfig::kBoardWidth * TConfig::kBoardHeight), entities_(TConfig::kBoardWidth * TConfig::kBoardHeight)
+        {
+            static_assert(TConfig::kBoardWidth % 2 == 0, "WIDTH must be even");
+
+            BackgroundCellFactory backgroundCellFactory(seed);
+            for (int row = 0; row < TConfig::kBoardHeight; ++row)
+            {
+                for (int col = 0; col < TConfig::kBoardWidth; ++col)
+                {
+                    auto numberCell = dynamic_cast<const NumberCell *>(backgroundCellFactory.Create().get());
+                    numbers_[GetIndex({row, col})] = numberCell ? numberCell->GetNumber() : 0;
+                }
+            }
+
+            Build(Kind::kCollectionCenter, kCollectionCenterTopLeft, Direction::kTop);
+
+            std::mt19937 gen(seed);
+            for (int k = 1; k <= TConfig::kNumberOfWalls; ++k)
+            {
+                CellPosition cellPosition;
+                cellPosition.row = gen() % TConfig::kBoardHeight;
+                cellPosition.col = gen() % TConfig::kBoardWidth;
+                if (entities_[GetIndex(cellPosition)] == nullptr)
+                {
+                    Build(Kind::kWall, cellPosition, Direction::kTop);
+                }
+            }
+        }
+
+        bool IsGameOver() const { return elapsedTime_ >= endTime_; }
+
+        int GetElapsedTime() const { return static_cast<int>(elapsedTime_); }
+
+        int GetScores() const { return scores_; }
+
+        // The ore under a cell, or 0.
+        int GetNumber(CellPosition cellPosition) const { return numbers_[GetIndex(cellPosition)]; }
+
+        bool CanBuild(CellPosition cellPosition) const
+        {
+            return IsWithinBoard(cellPosition) && entities_[GetIndex(cellPosition)] == nullptr;
+        }
+
+        // Equals GameManager::GetStateHash of the same game at GameManagerConfig.
+        std::size_t GetStateHash() const
+        {
+            std::size_t hash = 0;
+            for (int row = 0; row < TConfig::kBoardHeight; ++row)
+            {
+                for (int col = 0; col < TConfig::kBoardWidth; ++col)
+                {
+                    const Entity *entity = entities_[GetIndex({row, col})].get();
+                    if (entity == nullptr)
+                    {
+                        HashCombine(hash, 0);
+                        continue;
+                    }
+
+                    std::array<int, TConfig::kConveyorBufferSize> products{};
+                    std::size_t elapsedTime = 0;
+                    std::size_t kind = 0;
+
+                    switch (entity->kind)
+                    {
+                    case Kind::kWall:
+                        kind = typeid(WallCell).hash_code();
+                        break;
+                    case Kind::kCollectionCenter:
+                        kind = typeid(CollectionCenterCell).hash_code();
+                        break;
+                    case Kind::kConveyor:
+                        kind = typeid(ConveyorCell).hash_code();
+                        products = entity->products;
+                        break;
+                    case Kind::kCombiner:
+                        kind = typeid(CombinerCell).hash_code();
+                        products[0] = entity->products[0];
+                        products[1] = entity->products[1];
+                        break;
+                    case Kind::kMiningMachine:
+                        kind = typeid(MiningMachineCell).hash_code();
+                        elapsedTime = entity->elapsedTime;
+                        break;
+                    }
+                    HashForegroundCell(hash, kind, entity->topLeft, GetOutputDirection(*entity, {row, col}), products, elapsedTime);
+                }
+            }
+            HashCombine(hash, elapsedTime_);
+            HashCombine(hash, scores_);
+            return hash;
+        }
+
+        void Update()
+        {
+            if (elapsedTime_ >= endTime_)
+                return;
+
+            ++elapsedTime_;
+
+            if (elapsedTime_ % 3 == 0 && !actions_.empty())
+            {
+                ApplyAction(actions_.front());
+                actions_.pop();
+            }
+
+            for (int row = 0; row < TConfig::kBoardHeight; ++row)
+            {
+                for (int col = 0; col < TConfig::kBoardWidth; ++col)
+                {
+                    if (std::shared_ptr<Entity> entity = entities_[GetIndex({row, col})])
+                    {
+                        UpdatePassOne(*entity, {row, col});
+                    }
+                }
+            }
+            for (int row = 0; row < TConfig::kBoardHeight; ++row)
+            {
+                for (int col = 0; col < TConfig::kBoardWidth; ++col)
+                {
+                    if (std::shared_ptr<Entity> entity = entities_[GetIndex({row, col})])
+                    {
+                        UpdatePassTwo(*entity);
+                    }
+                }
+            }
+        }
+
+    private:
+        static constexpr std::size_t kBufferSize = TConfig::kConveyorBufferSize;
+        static constexpr CellPosition kCollectionCenterTopLeft{
+            static_cast<int>(TConfig::kBoardHeight / 2 - TConfig::kGoalSize / 2),
+            static_cast<int>(TConfig::kBoardWidth / 2 - TConfig::kGoalSize / 2)};
+
+        enum class Kind
+        {
+            kWall,
+            kCollectionCenter,
+            kConveyor,
+            kCombiner,
+            kMiningMachine,
+        };
+
+        // Shared by all the cells it covers. A combiner keeps its first slot in products[0] and its
+        // second in products[1], where CombinerCell::GetState puts them.
+        struct Entity
+        {
+            Kind kind;
+            CellPosition topLeft;
+            Direction direction;
+            std::array<int, TConfig::kConveyorBufferSize> products;
+            std::size_t elapsedTime;
+        };
+
+        static int GetIndex(CellPosition cellPosition)
+        {
+            return cellPosition.row * TConfig::kBoardWidth + cellPosition.col;
+        }
+
+        static bool IsWithinBoard(CellPosition cellPosition)
+        {
+            return cellPosition.row >= 0 && cellPosition.row < TConfig::kBoardHeight &&
+                   cellPosition.col >= 0 && cellPosition.col < TConfig::kBoardWidth;
+        }
+
+        static bool IsMainCell(const Entity &entity, CellPosition cellPosition)
+        {
+            bool isTopLeft = cellPosition == entity.topLeft;
+            return entity.direction == Direction::kBottom || entity.direction == Direction::kLeft ? isTopLeft : !isTopLeft;
+        }
+
+        // As ForegroundCell::GetOutputDirection.
+        static std::optional<Direction> GetOutputDirection(const Entity &entity, CellPosition cellPosition)
+        {
+            switch (entity.kind)
+            {
+            case Kind::kConveyor:
+            case Kind::kMiningMachine:
+                return entity.direction;
+            case Kind::kCombiner:
+                if (IsMainCell(entity, cellPosition))
+                    return entity.direction;
+                return std::nullopt;
+            default:
+                return std::nullopt;
+            }
+        }
+
+        std::size_t GetCapacity(CellPosition cellPosition) const
+        {
+            if (!IsWithinBoard(cellPosition) || entities_[GetIndex(cellPosition)] == nullptr)
+                return 0;
+
+            const Entity &entity = *entities_[GetIndex(cellPosition)];
+            switch (entity.kind)
+            {
+            case Kind::kConveyor:
+                for (std::size_t i = 0; i < kBufferSize; ++i)
+                {
+                    if (entity.products[kBufferSize - 1 - i] != 0)
+                        return i;
+                }
+                return kBufferSize;
+            case Kind::kCombiner:
+                return entity.products[IsMainCell(entity, cellPosition) ? 0 : 1] == 0 ? kBufferSize : 0;
+            case Kind::kCollectionCenter:
+                return kBufferSize;
+            default:
+                return 0;
+            }
+        }
+
+        void SendProduct(CellPosition cellPosition, int product)
+        {
+            if (!IsWithinBoard(cellPosition) || entities_[GetIndex(cellPosition)] == nullptr)
+                return;
+
+            Entity &entity = *entities_[GetIndex(cellPosition)];
+            switch (entity.kind)
+            {
+            case Kind::kConveyor:
+                entity.products[kBufferSize - 1] = product;
+                break;
+            case Kind::kCombiner:
+                entity.products[IsMainCell(entity, cellPosition) ? 0 : 1] = product;
+                break;
+            case Kind::kCollectionCenter:
+                scores_ += product % commonDividor_ == 0;
+                break;
+            default:
+                break;
+            }
+        }
+
+        void UpdatePassOne(Entity &entity, CellPosition cellPosition)
+        {
+            CellPosition target = GetNeighborCellPosition(cellPosition, entity.direction);
+
+            switch (entity.kind)
+            {
+            case Kind::kConveyor:
+            {
+                std::size_t capacity = GetCapacity(target);
+                std::array<int, TConfig::kConveyorBufferSize> &products = entity.products;
+                if (capacity >= 3 && products[0] != 0)
+                {
+                    SendProduct(target, products[0]);
+                    products[0] = 0;
+                }
+                if (capacity >= 2 && products[0] == 0 && products[1] != 0)
+                {
+                    std::swap(products[0], products[1]);
+                }
+                if (capacity >= 1 && products[0] == 0 && products[1] == 0 && products[2] != 0)
+                {
+                    std::swap(products[1], products[2]);
+                }
+                break;
+            }
+            case Kind::kCombiner:
+                if (IsMainCell(entity, cellPosition) && entity.products[0] != 0 && entity.products[1] != 0 &&
+                    GetCapacity(target) >= 3)
+                {
+                    SendProduct(target, entity.products[0] + entity.products[1]);
+                    entity.products[0] = 0;
+                    entity.products[1] = 0;
+                }
+                break;
+            case Kind::kMiningMachine:
+                if (++entity.elapsedTime >= 100)
+                {
+                    int number = numbers_[GetIndex(cellPosition)];
+                    if (number != 0 && GetCapacity(target) >= 3)
+                    {
+                        SendProduct(target, number);
+                    }
+                    entity.elapsedTime = 0;
+                }
+                break;
+            default:
+                break;
+            }
+        }
+
+        void UpdatePassTwo(Entity &entity)
+        {
+            if (entity.kind != Kind::kConveyor)
+                return;
+
+            std::array<int, TConfig::kConveyorBufferSize> &products = entity.products;
+            for (std::size_t k = 3; k < kBufferSize; ++k)
+            {
+                if (products[k] != 0 && products[k - 1] == 0 && products[k - 2] == 0 && products[k - 3] == 0)
+                {
+                    std::swap(products[k], products[k - 1]);
+                }
+            }
+        }
+
+        void ApplyAction(const PlayerAction &action)
+        {
+            BlueprintCell blueprintCell;
+            if (ToBlueprintCell(action, blueprintCell))
+            {
+                Kind kind = blueprintCell.type == BlueprintCellType::kMiningMachine ? Kind::kMiningMachine
+                            : blueprintCell.type == BlueprintCellType::kConveyor   ? Kind::kConveyor
+                                                                                   : Kind::kCombiner;
+                Build(kind, blueprintCell.cellPosition, blueprintCell.direction);
+            }
+            else if (action.type == PlayerActionType::Clear)
+            {
+                Remove(action.cellPosition);
+            }
+        }
+
+        // Width and height of an entity, as ForegroundCell::GetWidth and GetHeight give them.
+        static CellPosition GetSize(Kind kind, Direction direction)
+        {
+            bool horizontal = direction == Direction::kTop || direction == Direction::kBottom;
+            switch (kind)
+            {
+            case Kind::kCollectionCenter:
+                return {static_cast<int>(TConfig::kGoalSize), static_cast<int>(TConfig::kGoalSize)};
+            case Kind::kCombiner:
+                return horizontal ? CellPosition{1, 2} : CellPosition{2, 1};
+            default:
+                return {1, 1};
+            }
+        }
+
+        // Same rules as GameBoard::Build: every covered cell must be on the board and free of
+        // foreground entities.
+        void Build(Kind kind, CellPosition topLeft, Direction direction)
+        {
+            CellPosition size = GetSize(kind, direction);
+            for (int i = 0; i < size.row; ++i)
+            {
+                for (int j = 0; j < size.col; ++j)
+                {
+                    if (!CanBuild(topLeft + CellPosition{i, j}))
+                        return;
+                }
+            }
+
+            auto entity = std::make_shared<Entity>(Entity{kind, topLeft, direction, {}, 0});
+            for (int i = 0; i < size.row; ++i)
+            {
+                for (int j = 0; j < size.col; ++j)
+                {
+                    entities_[GetIndex(topLeft + CellPosition{i, j})] = entity;
+                }
+            }
+        }
+
+        void Remove(CellPosition cellPosition)
+        {
+            if (!IsWithinBoard(cellPosition) || entities_[GetIndex(cellPosition)] == nullptr)
+                return;
+
+            std::shared_ptr<Entity> entity = entities_[GetIndex(cellPosition)];
+            if (entity->kind == Kind::kWall || entity->kind == Kind::kCollectionCenter)
+                return;
+
+            CellPosition size = GetSize(entity->kind, entity->direction);
+            for (int i = 0; i < size.row; ++i)
+            {
+                for (int j = 0; j < size.col; ++j)
+                {
+                    entities_[GetIndex(entity->topLeft + CellPosition{i, j})] = nullptr;
+                }
+            }
+        }
+
+        std::size_t elapsedTime_;
+        std::size_t endTime_;
+        std::queue<PlayerAction> actions_;
+        int commonDividor_;
+        int scores_;
+        std::vector<int> numbers_;
+        std::vector<std::shared_ptr<Entity>> entities_;
+    };
+}
+#endif
@@ -0,0 +1,38 @@
+#ifndef REPLAY_HPP
+#define REPLAY_HPP
+#include <fstream>
+#include <queue>
+#include <string>
+#include "PDOGS.cpp"
+
+namespace Feis
+{
+    // Replay files hold one action per line as "row col type", in the order the player issued them.
+    bool SaveReplay(std::queue<PlayerAction> playerActions, const std::string &filename)
+    {
+        std::ofstream outFile(filename);
+        while (!playerActions.empty())
+        {
+            const PlayerAction &playerAction = playerActions.front();
+            outFile << playerAction.cellPosition.row << " " << playerAction.cellPosition.col << " " << static_cast<int>(playerAction.type) << std::endl;
+            playerActions.pop();
+        }
+        return static_cast<bool>(outFile);
+    }
+
+    std::queue<PlayerAction> LoadReplay(const std::string &filename)
+    {
+        std::queue<PlayerAction> playerActions;
+        std::ifstream inFile(filename);
+
+        PlayerAction playerAction;
+        int type;
+        while (inFile >> playerAction.cellPosition.row >> playerAction.cellPosition.col >> type)
+        {
+            playerAction.type = static_cast<PlayerActionType>(type);
+            playerActions.push(playerAction);
+        }
+        return playerActions;
+    }
+}
+#endif
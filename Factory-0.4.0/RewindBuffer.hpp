@@ -0,0 +1,143 @@
+#ifndef REWIND_BUFFER_HPP
+#define REWIND_BUFFER_HPP
+#include <deque>
+#include <mutex>
+#include <memory>
+#include <utility>
+#include "PDOGS.cpp"
+#include "ScriptedGamePlayer.hpp"
+
+namespace Feis
+{
+    // Keeps the recent past of a game so any tick in it can be looked at again: a fork every
+    // `interval` ticks, at most `capacity` of them, plus every action the player issued since the
+    // oldest one. Any tick in that window is rebuilt by replaying the logged actions on the latest
+    // fork at or before it, which takes at most `interval` updates. Forks share the immutable
+    // backgrounds, so a snapshot costs roughly the entities on the board. Recording and rebuilding
+    // may happen on different threads.
+    class RewindBuffer
+    {
+    public:
+        RewindBuffer(int interval, std::size_t capacity) : interval_{interval}, capacity_{capacity}, lastTick_{-1}
+        {
+        }
+
+        int GetInterval() const { return interval_; }
+
+        // Call with the game's tick 0 and after every update.
+        void Record(const GameManager &game)
+        {
+            int tick = game.GetElapsedTime();
+            std::shared_ptr<const GameManager> snapshot;
+
+            if (tick % interval_ == 0)
+            {
+                snapshot = game.Fork(nullptr);
+            }
+
+            std::lock_guard<std::mutex> lock(mutex_);
+            lastTick_ = tick;
+
+            if (snapshot == nullptr)
+                return;
+
+            snapshots_.emplace_back(tick, std::move(snapshot));
+            if (snapshots_.size() > capacity_)
+            {
+                snapshots_.pop_front();
+
+                while (!actions_.empty() && actions_.front().first <= snapshots_.front().first)
+                {
+                    actions_.pop_front();
+                }
+            }
+        }
+
+        // Call with every action the player returns, at the tick it is returned for.
+        void RecordAction(int tick, const PlayerAction &action)
+        {
+            std::lock_guard<std::mutex> lock(mutex_);
+            actions_.emplace_back(tick, action);
+        }
+
+        int GetOldestTick() const
+        {
+            std::lock_guard<std::mutex> lock(mutex_);
+            return snapshots_.empty() ? -1 : snapshots_.front().first;
+        }
+
+        int GetNewestTick() const
+        {
+            std::lock_guard<std::mutex> lock(mutex_);
+            return lastTick_;
+        }
+
+        // The game as it was right after `tick`, or nullptr if that is outside the window. The
+        // copy has no player.
+        std::unique_ptr<GameManager> Rebuild(int tick) const
+        {
+            std::shared_ptr<const GameManager> snapshot;
+            std::queue<PlayerAction> actions;
+            {
+                std::lock_guard<std::mutex> lock(mutex_);
+
+                if (snapshots_.empty() || tick < snapshots_.front().first || tick > lastTick_)
+                    return nullptr;
+
+                auto it = snapshots_.rbegin();
+                while (it->first > tick)
+                {
+                    ++it;
+                }
+                snapshot = it->second;
+
+                for (const auto &[actionTick, action] : actions_)
+                {
+                    if (actionTick > it->first && actionTick <= tick)
+                    {
+                        actions.push(action);
+                    }
+                }
+            }
+
+            ScriptedGamePlayer player(std::move(actions));
+            std::unique_ptr<GameManager> game = snapshot->Fork(&player);
+
+            while (game->GetElapsedTime() < tick)
+            {
+                game->Update();
+            }
+            return game->Fork(nullptr);
+        }
+
+    private:
+        int interval_;
+        std::size_t capacity_;
+        int lastTick_;
+        mutable std::mutex mutex_;
+        std::deque<std::pair<int, std::shared_ptr<const GameManager>>> snapshots_;
+        std::deque<std::pair<int, PlayerAction>> actions_;
+    };
+
+    // Passes another player's actions through and logs them in a RewindBuffer.
+    class RecordingGamePlayer : public IGamePlayer
+    {
+    public:
+        RecordingGamePlayer(IGamePlayer *player, RewindBuffer *rewindBuffer)
+            : player_(player), rewindBuffer_(rewindBuffer)
+        {
+        }
+
+        PlayerAction GetNextAction(const IGameInfo &info) override
+        {
+            PlayerAction action = player_->GetNextAction(info);
+            rewindBuffer_->RecordAction(info.GetElapsedTime(), action);
+            return action;
+        }
+
+    private:
+        IGamePlayer *player_;
+        RewindBuffer *rewindBuffer_;
+    };
+}
+#endif
@@ -0,0 +1,70 @@
+#ifndef SAVE_GAME_HPP
+#define SAVE_GAME_HPP
+#include <cstdio>
+#include <fstream>
+#include <memory>
+#include <string>
+#include "PDOGS.cpp"
+
+#if defined(__unix__) || defined(__APPLE__)
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#endif
+
+namespace Feis
+{
+    // Save files are a SavedGame image and nothing else, so a file is written in one sequential
+    // write and read back by mapping it, and both take the same time however long the game has run.
+    // The image is written next to the file and renamed over it, so an interrupted save leaves the
+    // previous file intact.
+    bool SaveGame(const GameManager &game, const std::string &filename)
+    {
+        auto savedGame = std::make_unique<SavedGame>();
+        game.Save(*savedGame);
+
+        std::string temporaryFilename = filename + ".tmp";
+        {
+            std::ofstream outFile(temporaryFilename, std::ios::binary | std::ios::trunc);
+            outFile.write(reinterpret_cast<const char *>(savedGame.get()), sizeof(SavedGame));
+            if (!outFile.flush())
+                return false;
+        }
+        return std::rename(temporaryFilename.c_str(), filename.c_str()) == 0;
+    }
+
+    // nullptr if the file is missing, truncated or from another version.
+    std::unique_ptr<GameManager> LoadGame(const std::string &filename, IGamePlayer *player)
+    {
+#if defined(__unix__) || defined(__APPLE__)
+        int file = open(filename.c_str(), O_RDONLY);
+        if (file < 0)
+            return nullptr;
+
+        struct stat fileStatus;
+        if (fstat(file, &fileStatus) != 0 || static_cast<std::size_t>(fileStatus.st_size) != sizeof(SavedGame))
+        {
+            close(file);
+            return nullptr;
+        }
+
+        void *image = mmap(nullptr, sizeof(SavedGame), PROT_READ, MAP_PRIVATE, file, 0);
+        close(file);
+        if (image == MAP_FAILED)
+            return nullptr;
+
+        std::unique_ptr<GameManager> game = GameManager::Load(*static_cast<const SavedGame *>(image), player);
+        munmap(image, sizeof(SavedGame));
+        return game;
+#else
+        auto savedGame = std::make_unique<SavedGame>();
+        std::ifstream inFile(filename, std::ios::binary);
+        if (!inFile.read(reinterpret_cast<char *>(savedGame.get()), sizeof(SavedGame)) || inFile.peek() != EOF)
+            return nullptr;
+
+        return GameManager::Load(*savedGame, player);
+#endif
+    }
+}
+#endif
@@ -0,0 +1,329 @@
+#ifndef SCENARIO_HPP
+#define SCENARIO_HPP
+#include <cstdint>
+#include <memory>
+#include <random>
+#include <string>
+#include <vector>
+#include "PDOGS.cpp"
+
+namespace Feis
+{
+    // A board before anything is built on it: ores, walls and the divisor. Each cell is one byte,
+    // the ore value under it (0 for none) with kWallBit set if a wall stands on it; walls may cover
+    // ores, as they do in GameManager. The collection center is not stored; it is always centred the
+    // way GameManager places it.
+    struct ScenarioView
+    {
+        static constexpr std::uint8_t kWallBit = 0x80;
+        static constexpr int kMaxOreValue = 0x7f;
+
+        int width;
+        int height;
+        int commonDividor;
+        std::uint64_t seed;
+        const std::uint8_t *cells;
+
+        int GetOreValue(CellPosition cellPosition) const
+        {
+            return cells[cellPosition.row * width + cellPosition.col] & ~kWallBit;
+        }
+
+        bool IsWall(CellPosition cellPosition) const
+        {
+            return (cells[cellPosition.row * width + cellPosition.col] & kWallBit) != 0;
+        }
+
+        CellPosition GetCollectionCenterTopLeft() const
+        {
+            return {height / 2 - static_cast<int>(GameManagerConfig::kGoalSize) / 2,
+                    width / 2 - static_cast<int>(GameManagerConfig::kGoalSize) / 2};
+        }
+
+        bool IsCollectionCenter(CellPosition cellPosition) const
+        {
+            CellPosition topLeft = GetCollectionCenterTopLeft();
+            return cellPosition.row >= topLeft.row && cellPosition.row < topLeft.row + static_cast<int>(GameManagerConfig::kGoalSize) &&
+                   cellPosition.col >= topLeft.col && cellPosition.col < topLeft.col + static_cast<int>(GameManagerConfig::kGoalSize);
+        }
+    };
+
+    // What Scenario::Generate varies. The defaults give boards like the judged ones, though not the
+    // same boards; Scenario::FromGameSeed gives those.
+    struct ScenarioParameters
+    {
+        int width = GameManagerConfig::kBoardWidth;
+        int height = GameManagerConfig::kBoardHeight;
+        int commonDividor = 1;
+        // Chance that a cell has an ore, and the values it is drawn from uniformly.
+        double oreDensity = 6.0 / 30;
+        std::vector<int> oreValues = {1, 2, 3, 5, 7, 11};
+        // Chance that a cell outside the collection center has a wall.
+        double wallDensity = static_cast<double>(GameManagerConfig::kNumberOfWalls) /
+                             (GameManagerConfig::kBoardWidth * GameManagerConfig::kBoardHeight);
+
+        bool IsValid() const
+        {
+            if (width < static_cast<int>(GameManagerConfig::kGoalSize) || width > 4096 ||
+                height < static_cast<int>(GameManagerConfig::kGoalSize) || height > 4096 || commonDividor < 1)
+                return false;
+            if (oreDensity < 0 || oreDensity > 1 || wallDensity < 0 || wallDensity > 1)
+                return false;
+            if (oreDensity > 0 && oreValues.empty())
+                return false;
+            for (int oreValue : oreValues)
+            {
+                if (oreValue < 1 || oreValue > ScenarioView::kMaxOreValue)
+                    return false;
+            }
+            return true;
+        }
+    };
+
+    class Scenario
+    {
+    public:
+        Scenario(int width, int height, int commonDividor, std::uint64_t seed)
+            : width_{width}, height_{height}, commonDividor_{commonDividor}, seed_{seed}, cells_(width * height) {}
+
+        // The board GameManager lays out for this divisor and seed.
+        static Scenario FromGameSeed(int commonDividor, unsigned int seed)
+        {
+            Scenario scenario(GameManagerConfig::kBoardWidth, GameManagerConfig::kBoardHeight, commonDividor, seed);
+
+            BackgroundCellFactory backgroundCellFactory(seed);
+            for (int row = 0; row < scenario.height_; ++row)
+            {
+                for (int col = 0; col < scenario.width_; ++col)
+                {
+                    auto numberCell = dynamic_cast<const NumberCell *>(backgroundCellFactory.Create().get());
+                    scenario.SetOreValue({row, col}, numberCell ? numberCell->GetNumber() : 0);
+                }
+            }
+
+            std::mt19937 gen(seed);
+            for (int k = 1; k <= GameManagerConfig::kNumberOfWalls; ++k)
+            {
+                CellPosition cellPosition;
+                cellPosition.row = gen() % GameManagerConfig::kBoardHeight;
+                cellPosition.col = gen() % GameManagerConfig::kBoardWidth;
+                if (!scenario.GetView().IsCollectionCenter(cellPosition))
+                {
+                    scenario.SetWall(cellPosition, true);
+                }
+            }
+            return scenario;
+        }
+
+        // The same parameters and seed always give the same board.
+        static Scenario Generate(const ScenarioParameters &parameters, std::uint64_t seed)
+        {
+            assert(parameters.IsValid());
+
+            Scenario scenario(parameters.width, parameters.height, parameters.commonDividor, seed);
+            std::mt19937_64 gen(seed);
+            std::uniform_real_distribution<double> chance(0, 1);
+
+            for (int row = 0; row < scenario.height_; ++row)
+            {
+                for (int col = 0; col < scenario.width_; ++col)
+                {
+                    if (chance(gen) < parameters.oreDensity)
+                    {
+                        scenario.SetOreValue({row, col}, parameters.oreValues[gen() % parameters.oreValues.size()]);
+                    }
+                    if (chance(gen) < parameters.wallDensity && !scenario.GetView().IsCollectionCenter({row, col}))
+                    {
+                        scenario.SetWall({row, col}, true);
+                    }
+                }
+            }
+            return scenario;
+        }
+
+        ScenarioView GetView() const
+        {
+            return {width_, height_, commonDividor_, seed_, cells_.data()};
+        }
+
+        void SetOreValue(CellPosition cellPosition, int oreValue)
+        {
+            assert(oreValue >= 0 && oreValue <= ScenarioView::kMaxOreValue);
+            std::uint8_t &cell = cells_[cellPosition.row * width_ + cellPosition.col];
+            cell = static_cast<std::uint8_t>((cell & ScenarioView::kWallBit) | oreValue);
+        }
+
+        void SetWall(CellPosition cellPosition, bool wall)
+        {
+            std::uint8_t &cell = cells_[cellPosition.row * width_ + cellPosition.col];
+            cell = static_cast<std::uint8_t>(wall ? cell | ScenarioView::kWallBit : cell & ~ScenarioView::kWallBit);
+        }
+
+    private:
+        int width_;
+        int height_;
+        int commonDividor_;
+        std::uint64_t seed_;
+        std::vector<std::uint8_t> cells_;
+    };
+
+    // Hand-made boards at the judged size that push players and engines to extremes.
+    enum class PathologicalScenario
+    {
+        // A wall ring around the collection center with a single gap.
+        kSealedCenter,
+        // Wall columns with alternating gaps, so every route snakes across the board.
+        kSerpentine,
+        // No ore anywhere.
+        kBarren,
+        // An ore on every cell and no walls, so any layout is possible and the board fills up.
+        kSaturated,
+        // Only ores of 1 and a divisor that needs deep combiner trees.
+        kOnlyOnes,
+        // Ores only in the four corners, as far from the collection center as they get.
+        kFarCorners,
+    };
+
+    constexpr PathologicalScenario kPathologicalScenarios[] = {
+        PathologicalScenario::kSealedCenter,
+        PathologicalScenario::kSerpentine,
+        PathologicalScenario::kBarren,
+        PathologicalScenario::kSaturated,
+        PathologicalScenario::kOnlyOnes,
+        PathologicalScenario::kFarCorners,
+    };
+
+    const char *GetPathologicalScenarioName(PathologicalScenario kind)
+    {
+        switch (kind)
+        {
+        case PathologicalScenario::kSealedCenter:
+            return "sealed-center";
+        case PathologicalScenario::kSerpentine:
+            return "serpentine";
+        case PathologicalScenario::kBarren:
+            return "barren";
+        case PathologicalScenario::kSaturated:
+            return "saturated";
+        case PathologicalScenario::kOnlyOnes:
+            return "only-ones";
+        case PathologicalScenario::kFarCorners:
+            return "far-corners";
+        }
+        assert(false);
+        return "";
+    }
+
+    Scenario MakePathologicalScenario(PathologicalScenario kind, std::uint64_t seed)
+    {
+        constexpr int kWidth = GameManagerConfig::kBoardWidth;
+        constexpr int kHeight = GameManagerConfig::kBoardHeight;
+        constexpr int kGoalSize = static_cast<int>(GameManagerConfig::kGoalSize);
+
+        std::mt19937_64 gen(seed);
+        const std::vector<int> oreValues = {1, 2, 3, 5, 7, 11};
+        auto randomOre = [&gen, &oreValues]()
+        {
+            return oreValues[gen() % oreValues.size()];
+        };
+
+        Scenario scenario(kWidth, kHeight, kind == PathologicalScenario::kOnlyOnes ? 5 : 1, seed);
+        CellPosition center = scenario.GetView().GetCollectionCenterTopLeft();
+
+        for (int row = 0; row < kHeight; ++row)
+        {
+            for (int col = 0; col < kWidth; ++col)
+            {
+                CellPosition cellPosition{row, col};
+                int ringRow = row - center.row;
+                int ringCol = col - center.col;
+                bool onRing = ringRow >= -2 && ringRow <= kGoalSize + 1 && ringCol >= -2 && ringCol <= kGoalSize + 1 &&
+                              (ringRow == -2 || ringRow == kGoalSize + 1 || ringCol == -2 || ringCol == kGoalSize + 1);
+
+                switch (kind)
+                {
+                case PathologicalScenario::kSealedCenter:
+                    if (gen() % 5 == 0)
+                    {
+                        scenario.SetOreValue(cellPosition, randomOre());
+                    }
+                    scenario.SetWall(cellPosition, onRing && !(ringRow == -2 && ringCol == 0));
+                    break;
+                case PathologicalScenario::kSerpentine:
+                    if (gen() % 5 == 0)
+                    {
+                        scenario.SetOreValue(cellPosition, randomOre());
+                    }
+                    // Every third column is a wall except for a gap at the top or the bottom.
+                    if (col % 3 == 2 && !scenario.GetView().IsCollectionCenter(cellPosition))
+                    {
+                        bool gapAtTop = col / 3 % 2 == 0;
+                        scenario.SetWall(cellPosition, gapAtTop ? row != 0 : row != kHeight - 1);
+                    }
+                    break;
+                case PathologicalScenario::kBarren:
+                    break;
+                case PathologicalScenario::kSaturated:
+                    scenario.SetOreValue(cellPosition, randomOre());
+                    break;
+                case PathologicalScenario::kOnlyOnes:
+                    if (gen() % 5 == 0)
+                    {
+                        scenario.SetOreValue(cellPosition, 1);
+                    }
+                    break;
+                case PathologicalScenario::kFarCorners:
+                    if ((row < 4 || row >= kHeight - 4) && (col < 4 || col >= kWidth - 4))
+                    {
+                        scenario.SetOreValue(cellPosition, randomOre());
+                    }
+                    break;
+                }
+            }
+        }
+        return scenario;
+    }
+
+    // The game a scenario at the judged board size starts, with `player` in the only seat; nullptr
+    // for other sizes.
+    std::unique_ptr<GameManager> StartScenario(const ScenarioView &scenario, IGamePlayer *player)
+    {
+        if (scenario.width != GameManagerConfig::kBoardWidth || scenario.height != GameManagerConfig::kBoardHeight ||
+            scenario.commonDividor < 1)
+            return nullptr;
+
+        auto savedGame = std::make_unique<SavedGame>();
+        savedGame->magic = SavedGame::kMagic;
+        savedGame->version = SavedGame::kVersion;
+        savedGame->width = GameManagerConfig::kBoardWidth;
+        savedGame->height = GameManagerConfig::kBoardHeight;
+        savedGame->endTime = GameManagerConfig::kEndTime;
+        savedGame->commonDividor = scenario.commonDividor;
+        savedGame->playerCount = 1;
+
+        CellPosition center = scenario.GetCollectionCenterTopLeft();
+        for (int row = 0; row < GameManagerConfig::kBoardHeight; ++row)
+        {
+            for (int col = 0; col < GameManagerConfig::kBoardWidth; ++col)
+            {
+                SavedGame::Cell &cell = savedGame->cells[row][col];
+                cell.number = scenario.GetOreValue({row, col});
+                cell.topLeftRow = static_cast<std::int16_t>(row);
+                cell.topLeftCol = static_cast<std::int16_t>(col);
+
+                if (scenario.IsCollectionCenter({row, col}))
+                {
+                    cell.kind = SavedGame::kCollectionCenter;
+                    cell.topLeftRow = static_cast<std::int16_t>(center.row);
+                    cell.topLeftCol = static_cast<std::int16_t>(center.col);
+                }
+                else if (scenario.IsWall({row, col}))
+                {
+                    cell.kind = SavedGame::kWall;
+                }
+            }
+        }
+        return GameManager::Load(*savedGame, player);
+    }
+}
+#endif
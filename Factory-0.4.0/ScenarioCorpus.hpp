@@ -0,0 +1,205 @@
+#ifndef SCENARIO_CORPUS_HPP
+#define SCENARIO_CORPUS_HPP
+#include <cstdint>
+#include <cstdio>
+#include <fstream>
+#include <iterator>
+#include <memory>
+#include <string>
+#include <vector>
+#include "PDOGS.cpp"
+#include "Scenario.hpp"
+
+#if defined(__unix__) || defined(__APPLE__)
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#endif
+
+namespace Feis
+{
+    // A corpus file is a header, the cells of every scenario back to back, and an index with one
+    // entry per scenario at the end, so a writer streams scenarios out as they are generated and a
+    // reader maps the file and reaches any scenario through the index without parsing the others.
+    struct ScenarioCorpusFormat
+    {
+        static constexpr std::uint32_t kMagic = 0x4E435346; // "FSCN" read as little-endian bytes
+        static constexpr std::uint32_t kVersion = 1;
+
+        struct Header
+        {
+            std::uint32_t magic;
+            std::uint32_t version;
+            std::uint32_t count;
+            std::uint32_t reserved;
+            std::uint64_t indexOffset;
+        };
+
+        struct IndexEntry
+        {
+            std::uint64_t cellsOffset;
+            std::uint64_t seed;
+            std::uint16_t width;
+            std::uint16_t height;
+            std::int32_t commonDividor;
+            std::uint64_t reserved;
+        };
+    };
+
+    static_assert(sizeof(ScenarioCorpusFormat::Header) == 24, "ScenarioCorpusFormat::Header must have no hidden padding");
+    static_assert(sizeof(ScenarioCorpusFormat::IndexEntry) == 32, "ScenarioCorpusFormat::IndexEntry must have no hidden padding");
+
+    // Writes next to the file and renames it over the file in Finish, so an unfinished corpus never
+    // replaces a finished one.
+    class ScenarioCorpusWriter
+    {
+    public:
+        ScenarioCorpusWriter(const std::string &filename)
+            : filename_{filename}, outFile_(filename + ".tmp", std::ios::binary | std::ios::trunc), offset_{sizeof(ScenarioCorpusFormat::Header)}
+        {
+            ScenarioCorpusFormat::Header header{};
+            outFile_.write(reinterpret_cast<const char *>(&header), sizeof(header));
+        }
+
+        void Add(const ScenarioView &scenario)
+        {
+            std::size_t size = static_cast<std::size_t>(scenario.width) * scenario.height;
+            index_.push_back({offset_, scenario.seed, static_cast<std::uint16_t>(scenario.width),
+                              static_cast<std::uint16_t>(scenario.height), scenario.commonDividor, 0});
+            outFile_.write(reinterpret_cast<const char *>(scenario.cells), size);
+            offset_ += size;
+        }
+
+        bool Finish()
+        {
+            // The index is read in place, so it starts on an 8-byte boundary.
+            std::uint64_t indexOffset = (offset_ + 7) / 8 * 8;
+            const char padding[8] = {};
+            outFile_.write(padding, indexOffset - offset_);
+            outFile_.write(reinterpret_cast<const char *>(index_.data()), index_.size() * sizeof(ScenarioCorpusFormat::IndexEntry));
+
+            ScenarioCorpusFormat::Header header{ScenarioCorpusFormat::kMagic, ScenarioCorpusFormat::kVersion,
+                                                static_cast<std::uint32_t>(index_.size()), 0, indexOffset};
+            outFile_.seekp(0);
+            outFile_.write(reinterpret_cast<const char *>(&header), sizeof(header));
+            outFile_.close();
+            if (!outFile_)
+                return false;
+
+            std::string temporaryFilename = filename_ + ".tmp";
+            return std::rename(temporaryFilename.c_str(), filename_.c_str()) == 0;
+        }
+
+    private:
+        std::string filename_;
+        std::ofstream outFile_;
+        std::uint64_t offset_;
+        std::vector<ScenarioCorpusFormat::IndexEntry> index_;
+    };
+
+    // Read-only view of a corpus file. On POSIX the file is mapped, so opening costs the same for
+    // any number of scenarios and only the pages of the scenarios read are loaded; elsewhere it is
+    // read whole. Views from Get stay valid as long as the corpus.
+    class ScenarioCorpus
+    {
+    public:
+        // nullptr if the file is missing, from another version or inconsistent with its index.
+        static std::unique_ptr<ScenarioCorpus> Open(const std::string &filename)
+        {
+            std::unique_ptr<ScenarioCorpus> corpus(new ScenarioCorpus());
+
+#if defined(__unix__) || defined(__APPLE__)
+            int file = open(filename.c_str(), O_RDONLY);
+            if (file < 0)
+                return nullptr;
+
+            struct stat fileStatus;
+            if (fstat(file, &fileStatus) != 0 || fileStatus.st_size < static_cast<off_t>(sizeof(ScenarioCorpusFormat::Header)))
+            {
+                close(file);
+                return nullptr;
+            }
+
+            corpus->size_ = static_cast<std::size_t>(fileStatus.st_size);
+            void *image = mmap(nullptr, corpus->size_, PROT_READ, MAP_PRIVATE, file, 0);
+            close(file);
+            if (image == MAP_FAILED)
+                return nullptr;
+            corpus->image_ = static_cast<const char *>(image);
+#else
+            std::ifstream inFile(filename, std::ios::binary);
+            corpus->buffer_.assign(std::istreambuf_iterator<char>(inFile), std::istreambuf_iterator<char>());
+            corpus->size_ = corpus->buffer_.size();
+            corpus->image_ = corpus->buffer_.data();
+            if (corpus->size_ < sizeof(ScenarioCorpusFormat::Header))
+                return nullptr;
+#endif
+
+            if (!corpus->IsConsistent())
+                return nullptr;
+            return corpus;
+        }
+
+        ScenarioCorpus(const ScenarioCorpus &) = delete;
+        ScenarioCorpus &operator=(const ScenarioCorpus &) = delete;
+
+        ~ScenarioCorpus()
+        {
+#if defined(__unix__) || defined(__APPLE__)
+            if (image_ != nullptr)
+            {
+                munmap(const_cast<char *>(image_), size_);
+            }
+#endif
+        }
+
+        std::size_t GetCount() const { return GetHeader().count; }
+
+        ScenarioView Get(std::size_t index) const
+        {
+            const ScenarioCorpusFormat::IndexEntry &entry = GetIndex()[index];
+            return {entry.width, entry.height, entry.commonDividor, entry.seed,
+                    reinterpret_cast<const std::uint8_t *>(image_ + entry.cellsOffset)};
+        }
+
+    private:
+        ScenarioCorpus() = default;
+
+        const ScenarioCorpusFormat::Header &GetHeader() const
+        {
+            return *reinterpret_cast<const ScenarioCorpusFormat::Header *>(image_);
+        }
+
+        const ScenarioCorpusFormat::IndexEntry *GetIndex() const
+        {
+            return reinterpret_cast<const ScenarioCorpusFormat::IndexEntry *>(image_ + GetHeader().indexOffset);
+        }
+
+        bool IsConsistent() const
+        {
+            const ScenarioCorpusFormat::Header &header = GetHeader();
+            if (header.magic != ScenarioCorpusFormat::kMagic || header.version != ScenarioCorpusFormat::kVersion ||
+                header.indexOffset % 8 != 0 || header.indexOffset > size_ ||
+                (size_ - header.indexOffset) / sizeof(ScenarioCorpusFormat::IndexEntry) < header.count)
+                return false;
+
+            for (std::size_t k = 0; k < header.count; ++k)
+            {
+                const ScenarioCorpusFormat::IndexEntry &entry = GetIndex()[k];
+                std::uint64_t size = static_cast<std::uint64_t>(entry.width) * entry.height;
+                if (entry.cellsOffset < sizeof(ScenarioCorpusFormat::Header) || entry.cellsOffset > header.indexOffset ||
+                    size > header.indexOffset - entry.cellsOffset || entry.commonDividor < 1)
+                    return false;
+            }
+            return true;
+        }
+
+        const char *image_ = nullptr;
+        std::size_t size_ = 0;
+#if !(defined(__unix__) || defined(__APPLE__))
+        std::vector<char> buffer_;
+#endif
+    };
+}
+#endif
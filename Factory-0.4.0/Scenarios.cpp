@@ -0,0 +1,222 @@
+#define USE_HEADLESS
+#include <algorithm>
+#include <chrono>
+#include <iostream>
+#include <sstream>
+#include <string>
+#include <vector>
+
+#include "PDOGS.cpp"
+#include "ConveyorRouter.hpp"
+#include "CombinerPlanner.hpp"
+#include "ScriptedGamePlayer.hpp"
+#include "ThreadPool.hpp"
+#include "Scenario.hpp"
+#include "ScenarioCorpus.hpp"
+
+using namespace Feis;
+
+// Reads key=value options over the defaults: width, height, divisor (0 draws 1 to 5 per scenario),
+// ores (density), values (comma-separated ore values) and walls (density).
+bool ParseParameters(int argc, char **argv, ScenarioParameters &parameters, bool &randomDividor)
+{
+    randomDividor = false;
+    for (int k = 0; k < argc; ++k)
+    {
+        std::string option = argv[k];
+        std::size_t separator = option.find('=');
+        if (separator == std::string::npos)
+            return false;
+
+        std::string key = option.substr(0, separator);
+        std::string value = option.substr(separator + 1);
+        if (key == "width")
+        {
+            parameters.width = std::stoi(value);
+        }
+        else if (key == "height")
+        {
+            parameters.height = std::stoi(value);
+        }
+        else if (key == "divisor")
+        {
+            parameters.commonDividor = std::stoi(value);
+            randomDividor = parameters.commonDividor == 0;
+            parameters.commonDividor = std::max(parameters.commonDividor, 1);
+        }
+        else if (key == "ores")
+        {
+            parameters.oreDensity = std::stod(value);
+        }
+        else if (key == "walls")
+        {
+            parameters.wallDensity = std::stod(value);
+        }
+        else if (key == "values")
+        {
+            parameters.oreValues.clear();
+            std::istringstream values(value);
+            for (std::string oreValue; std::getline(values, oreValue, ',');)
+            {
+                parameters.oreValues.push_back(std::stoi(oreValue));
+            }
+        }
+        else
+        {
+            return false;
+        }
+    }
+    return parameters.IsValid();
+}
+
+int Generate(const std::string &filename, std::size_t count, std::uint64_t firstSeed, ScenarioParameters parameters, bool randomDividor)
+{
+    ScenarioCorpusWriter writer(filename);
+    for (std::size_t k = 0; k < count; ++k)
+    {
+        std::uint64_t seed = firstSeed + k;
+        if (randomDividor)
+        {
+            parameters.commonDividor = 1 + static_cast<int>(seed % 5);
+        }
+        writer.Add(Scenario::Generate(parameters, seed).GetView());
+    }
+
+    if (!writer.Finish())
+    {
+        std::cout << "Cannot write " << filename << std::endl;
+        return 1;
+    }
+    std::cout << "Wrote " << count << " scenarios to " << filename << std::endl;
+    return 0;
+}
+
+// The judged boards for divisors 1 to 5 and the given seeds, followed by the pathological maps.
+int WriteStandard(const std::string &filename, std::uint64_t firstSeed, std::size_t seedCount)
+{
+    ScenarioCorpusWriter writer(filename);
+    std::size_t count = 0;
+    for (int commonDividor = 1; commonDividor <= 5; ++commonDividor)
+    {
+        for (std::size_t k = 0; k < seedCount; ++k, ++count)
+        {
+            writer.Add(Scenario::FromGameSeed(commonDividor, static_cast<unsigned int>(firstSeed + k)).GetView());
+        }
+    }
+    for (PathologicalScenario kind : kPathologicalScenarios)
+    {
+        writer.Add(MakePathologicalScenario(kind, firstSeed).GetView());
+        ++count;
+    }
+
+    if (!writer.Finish())
+    {
+        std::cout << "Cannot write " << filename << std::endl;
+        return 1;
+    }
+    std::cout << "Wrote " << count << " scenarios to " << filename << std::endl;
+    return 0;
+}
+
+// Score of the greedy plan, or -1 if the scenario is not of the judged size.
+int PlayScenario(const ScenarioView &scenario)
+{
+    ScriptedGamePlayer planningPlayer;
+    std::unique_ptr<GameManager> planningGame = StartScenario(scenario, &planningPlayer);
+    if (planningGame == nullptr)
+        return -1;
+
+    ConveyorRouter router(*planningGame);
+    CombinerPlanner planner(*planningGame);
+    ScriptedGamePlayer player(planner.Plan(*planningGame, router, GameManagerConfig::kEndTime / 3));
+    std::unique_ptr<GameManager> game = StartScenario(scenario, &player);
+    while (!game->IsGameOver())
+    {
+        game->Update();
+    }
+    return game->GetScores();
+}
+
+// Plays the greedy plan on every scenario of the judged size, a chunk at a time on the thread pool,
+// and prints the scores in corpus order. Other sizes have no GameManager and are skipped.
+int Run(const std::string &filename)
+{
+    std::unique_ptr<ScenarioCorpus> corpus = ScenarioCorpus::Open(filename);
+    if (corpus == nullptr)
+    {
+        std::cout << "Cannot read " << filename << std::endl;
+        return 1;
+    }
+
+    ThreadPool pool;
+    std::size_t chunkSize = 8 * pool.GetThreadCount();
+    std::vector<int> scores(chunkSize);
+    std::size_t playedCount = 0;
+    std::size_t zeroCount = 0;
+    long long totalScore = 0;
+
+    auto startTime = std::chrono::steady_clock::now();
+    for (std::size_t first = 0; first < corpus->GetCount(); first += chunkSize)
+    {
+        std::size_t last = std::min(first + chunkSize, corpus->GetCount());
+        for (std::size_t k = first; k < last; ++k)
+        {
+            pool.Submit([&corpus, &scores, first, k]
+                        { scores[k - first] = PlayScenario(corpus->Get(k)); });
+        }
+        pool.Wait();
+
+        for (std::size_t k = first; k < last; ++k)
+        {
+            ScenarioView scenario = corpus->Get(k);
+            std::cout << k << " seed " << scenario.seed << " divisor " << scenario.commonDividor << " "
+                      << scenario.width << "x" << scenario.height << ": ";
+            if (scores[k - first] < 0)
+            {
+                std::cout << "skipped" << std::endl;
+                continue;
+            }
+
+            std::cout << "score " << scores[k - first] << std::endl;
+            ++playedCount;
+            zeroCount += scores[k - first] == 0;
+            totalScore += scores[k - first];
+        }
+    }
+
+    double seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - startTime).count();
+    std::cout << "Played " << playedCount << " of " << corpus->GetCount() << " scenarios, mean score "
+              << static_cast<double>(totalScore) / std::max<std::size_t>(playedCount, 1) << ", " << zeroCount
+              << " scoring nothing, " << playedCount / seconds << " scenarios/s" << std::endl;
+    return 0;
+}
+
+int main(int argc, char **argv)
+{
+    std::string mode = argc > 1 ? argv[1] : "";
+
+    if (mode == "generate" && argc >= 5)
+    {
+        ScenarioParameters parameters;
+        bool randomDividor;
+        if (ParseParameters(argc - 5, argv + 5, parameters, randomDividor))
+        {
+            return Generate(argv[2], std::stoul(argv[3]), std::stoull(argv[4]), parameters, randomDividor);
+        }
+    }
+
+    if (mode == "standard" && argc >= 5)
+    {
+        return WriteStandard(argv[2], std::stoull(argv[3]), std::stoul(argv[4]));
+    }
+
+    if (mode == "run" && argc >= 3)
+    {
+        return Run(argv[2]);
+    }
+
+    std::cout << "Usage: Scenarios generate <corpus> <count> <first seed> [width=] [height=] [divisor=] [ores=] [values=] [walls=]" << std::endl;
+    std::cout << "       Scenarios standard <corpus> <first seed> <seeds per divisor>" << std::endl;
+    std::cout << "       Scenarios run <corpus>" << std::endl;
+    return 1;
+}
@@ -0,0 +1,42 @@
+#ifndef SCRIPTED_GAME_PLAYER_HPP
+#define SCRIPTED_GAME_PLAYER_HPP
+#include <queue>
+#include "PDOGS.cpp"
+
+namespace Feis
+{
+    // Plays back queued actions one per call and does nothing once the queue runs out.
+    class ScriptedGamePlayer : public IGamePlayer
+    {
+    public:
+        ScriptedGamePlayer() = default;
+
+        ScriptedGamePlayer(std::queue<PlayerAction> actions) : actions_(std::move(actions)) {}
+
+        PlayerAction GetNextAction(const IGameInfo &info) override
+        {
+            if (actions_.empty())
+            {
+                return {PlayerActionType::None, {0, 0}};
+            }
+
+            PlayerAction action = actions_.front();
+            actions_.pop();
+            return action;
+        }
+
+        void EnqueueAction(const PlayerAction &action)
+        {
+            actions_.push(action);
+        }
+
+        std::size_t GetPendingActionCount() const
+        {
+            return actions_.size();
+        }
+
+    private:
+        std::queue<PlayerAction> actions_;
+    };
+}
+#endif
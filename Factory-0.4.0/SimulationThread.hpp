@@ -0,0 +1,214 @@
+#ifndef SIMULATION_THREAD_HPP
+#define SIMULATION_THREAD_HPP
+#include <thread>
+#include <mutex>
+#include <atomic>
+#include <chrono>
+#include <memory>
+#include "PDOGS.cpp"
+#include "RewindBuffer.hpp"
+
+namespace Feis
+{
+    // Runs a game on its own thread, paced at a fixed tick rate (kUnlimited for as fast as
+    // possible) or adaptively: then the simulation spends kAdaptiveBudget of every display frame
+    // on as many ticks as fit and leaves the rest to the renderer. It can be paused. Readers never touch the live game: after a snapshot has been taken by GetSnapshot,
+    // the simulation forks a fresh one after its next tick and swaps it in, so the game is copied
+    // at most once per rendered frame and a snapshot is never modified once published. Each
+    // snapshot reports as dirty the cells that changed since the previous one; since a new one is
+    // only forked after the previous one was taken, a reader never skips a snapshot.
+    class SimulationThread
+    {
+    public:
+        static constexpr double kUnlimited = 0;
+        static constexpr double kAdaptiveBudget = 0.75;
+
+        SimulationThread(GameManager *game, double ticksPerSecond)
+            : game_(game),
+              ticksPerSecond_{ticksPerSecond},
+              framesPerSecond_{0},
+              adaptive_{false},
+              paused_{false},
+              pacingVersion_{0},
+              running_{false},
+              snapshotRequested_{false}
+        {
+            game_->EnableDirtyTracking(true);
+            Publish();
+        }
+
+        SimulationThread(const SimulationThread &) = delete;
+
+        SimulationThread &operator=(const SimulationThread &) = delete;
+
+        ~SimulationThread()
+        {
+            Stop();
+        }
+
+        void Start()
+        {
+            if (running_.exchange(true))
+                return;
+
+            thread_ = std::thread(&SimulationThread::Run, this);
+        }
+
+        void Stop()
+        {
+            running_ = false;
+
+            if (thread_.joinable())
+            {
+                thread_.join();
+            }
+        }
+
+        double GetTicksPerSecond() const { return ticksPerSecond_; }
+
+        void SetTicksPerSecond(double ticksPerSecond)
+        {
+            ticksPerSecond_ = ticksPerSecond;
+            adaptive_ = false;
+            ++pacingVersion_;
+        }
+
+        bool IsAdaptive() const { return adaptive_; }
+
+        void SetAdaptive(double framesPerSecond)
+        {
+            framesPerSecond_ = framesPerSecond;
+            adaptive_ = true;
+            ++pacingVersion_;
+        }
+
+        bool IsPaused() const { return paused_; }
+
+        void SetPaused(bool paused)
+        {
+            paused_ = paused;
+            ++pacingVersion_;
+        }
+
+        // Records the game into rewindBuffer after every tick. Call before Start.
+        void SetRewindBuffer(RewindBuffer *rewindBuffer)
+        {
+            rewindBuffer_ = rewindBuffer;
+            rewindBuffer_->Record(*game_);
+        }
+
+        // The most recently published snapshot; also asks the simulation for a newer one.
+        std::shared_ptr<const GameManager> GetSnapshot()
+        {
+            std::shared_ptr<const GameManager> snapshot;
+            {
+                std::lock_guard<std::mutex> lock(snapshotMutex_);
+                snapshot = snapshot_;
+            }
+
+            snapshotRequested_ = true;
+            return snapshot;
+        }
+
+    private:
+        using Clock = std::chrono::steady_clock;
+
+        void Run()
+        {
+            unsigned int pacingVersion = pacingVersion_;
+            Clock::time_point start = Clock::now();
+            std::size_t ticks = 0;
+
+            while (running_)
+            {
+                if (pacingVersion != pacingVersion_ || paused_)
+                {
+                    pacingVersion = pacingVersion_;
+                    start = Clock::now();
+                    ticks = 0;
+                }
+
+                if (paused_)
+                {
+                    std::this_thread::sleep_for(std::chrono::milliseconds(10));
+                    continue;
+                }
+
+                if (game_->IsGameOver())
+                {
+                    if (snapshot_->GetElapsedTime() != game_->GetElapsedTime() && snapshotRequested_.exchange(false))
+                    {
+                        Publish();
+                    }
+                    std::this_thread::sleep_for(std::chrono::milliseconds(10));
+                    continue;
+                }
+
+                if (adaptive_)
+                {
+                    // start is the beginning of the current frame.
+                    auto frame = std::chrono::duration_cast<Clock::duration>(
+                        std::chrono::duration<double>(1 / framesPerSecond_));
+                    Clock::time_point now = Clock::now();
+
+                    if (now >= start + frame)
+                    {
+                        start = now;
+                    }
+                    else if (now >= start + frame * kAdaptiveBudget)
+                    {
+                        std::this_thread::sleep_until(start + frame);
+                        continue;
+                    }
+                }
+                else if (ticksPerSecond_ != kUnlimited)
+                {
+                    auto due = start + std::chrono::duration_cast<Clock::duration>(
+                                           std::chrono::duration<double>(ticks / ticksPerSecond_));
+                    if (Clock::now() < due)
+                    {
+                        std::this_thread::sleep_until(std::min(due, Clock::now() + std::chrono::milliseconds(10)));
+                        continue;
+                    }
+                }
+
+                game_->Update();
+                ++ticks;
+
+                if (rewindBuffer_)
+                {
+                    rewindBuffer_->Record(*game_);
+                }
+
+                if (snapshotRequested_.exchange(false))
+                {
+                    Publish();
+                }
+            }
+        }
+
+        // Only this thread writes snapshot_, so it may read it without the lock.
+        void Publish()
+        {
+            std::shared_ptr<const GameManager> snapshot = game_->Fork(nullptr);
+            game_->ClearDirtyCells();
+
+            std::lock_guard<std::mutex> lock(snapshotMutex_);
+            snapshot_.swap(snapshot);
+        }
+
+        GameManager *game_;
+        RewindBuffer *rewindBuffer_ = nullptr;
+        std::atomic<double> ticksPerSecond_;
+        std::atomic<double> framesPerSecond_;
+        std::atomic<bool> adaptive_;
+        std::atomic<bool> paused_;
+        std::atomic<unsigned int> pacingVersion_;
+        std::atomic<bool> running_;
+        std::atomic<bool> snapshotRequested_;
+        std::mutex snapshotMutex_;
+        std::shared_ptr<const GameManager> snapshot_;
+        std::thread thread_;
+    };
+}
+#endif
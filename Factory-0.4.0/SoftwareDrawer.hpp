@@ -0,0 +1,427 @@
+#ifndef SOFTWARE_DRAWER_HPP
+#define SOFTWARE_DRAWER_HPP
+#include <algorithm>
+#include <cmath>
+#include <cstdint>
+#include <cstdio>
+#include <string>
+#include <vector>
+#include "PDOGS.cpp"
+
+// Counterpart of Drawer that needs no window or display: the same drawing calls are rasterized
+// into a preallocated RGB buffer, which can be written out as a binary PPM image. Shapes and texts
+// are batched and flushed in the same order as Drawer's. Text uses a built-in 3x5 bitmap font with
+// the digits and the few symbols the game displays; other characters are left blank.
+template <typename TGameRendererConfig>
+class SoftwareDrawer
+{
+public:
+    using CellPosition = Feis::CellPosition;
+    using Direction = Feis::Direction;
+
+    struct Primitive
+    {
+        enum class Kind
+        {
+            kRectangle,
+            kTriangle,
+            kCircle
+        };
+
+        Kind kind;
+        // A rectangle uses its top-left and bottom-right corners, a circle its centre.
+        sf::Vector2f points[3];
+        float radius;
+        sf::Color color;
+    };
+
+    struct Geometry
+    {
+        std::vector<Primitive> shapes;
+        std::vector<Primitive> texts;
+    };
+
+    SoftwareDrawer(unsigned int width, unsigned int height)
+        : width_(width), height_(height), pixels_(static_cast<std::size_t>(width) * height * 3)
+    {
+    }
+
+    unsigned int GetWidth() const { return width_; }
+
+    unsigned int GetHeight() const { return height_; }
+
+    // Row-major RGB, three bytes per pixel.
+    const std::vector<std::uint8_t> &GetPixels() const { return pixels_; }
+
+    void Clear()
+    {
+        std::fill(pixels_.begin(), pixels_.end(), 0);
+    }
+
+    void Display()
+    {
+    }
+
+    // Replaces the whole frame with a buffer previously taken from GetPixels.
+    void DrawLayer(const std::vector<std::uint8_t> &pixels)
+    {
+        Flush();
+        std::copy(pixels.begin(), pixels.end(), pixels_.begin());
+    }
+
+    void Flush()
+    {
+        for (const Primitive &primitive : batch_.shapes)
+        {
+            Rasterize(primitive);
+        }
+        for (const Primitive &primitive : batch_.texts)
+        {
+            Rasterize(primitive);
+        }
+        batch_.shapes.clear();
+        batch_.texts.clear();
+    }
+
+    void BeginRecording(Geometry *geometry)
+    {
+        geometry->shapes.clear();
+        geometry->texts.clear();
+        recording_ = geometry;
+    }
+
+    void EndRecording()
+    {
+        recording_ = nullptr;
+    }
+
+    void DrawGeometry(const Geometry &geometry)
+    {
+        batch_.shapes.insert(batch_.shapes.end(), geometry.shapes.begin(), geometry.shapes.end());
+        batch_.texts.insert(batch_.texts.end(), geometry.texts.begin(), geometry.texts.end());
+    }
+
+    void DrawBorder(CellPosition cellPosition)
+    {
+        sf::Vector2f topLeft = GetCellTopLeft(cellPosition);
+        sf::Vector2f border(TGameRendererConfig::kBorderSize, TGameRendererConfig::kBorderSize);
+        sf::Vector2f size(TGameRendererConfig::kCellSize, TGameRendererConfig::kCellSize);
+
+        AppendRectangle(GetShapes(), topLeft, topLeft + size, sf::Color(60, 60, 60));
+        AppendRectangle(GetShapes(), topLeft + border, topLeft + size - border, sf::Color::Black);
+    }
+
+    void DrawText(
+        std::string str,
+        unsigned int characterSize,
+        sf::Color color,
+        sf::Vector2f position,
+        Direction direction = Direction::kTop)
+    {
+        const float scale = std::max(1u, (characterSize + 3) / 7);
+        const sf::Vector2f size((4.0f * str.size() - 1) * scale, 5.0f * scale);
+        std::vector<Primitive> &texts = recording_ ? recording_->texts : batch_.texts;
+
+        for (std::size_t k = 0; k < str.size(); ++k)
+        {
+            const std::uint8_t *rows = GetGlyph(str[k]);
+            if (rows == nullptr)
+                continue;
+
+            for (int row = 0; row < 5; ++row)
+            {
+                for (int col = 0; col < 3; ++col)
+                {
+                    if ((rows[row] >> (2 - col) & 1) == 0)
+                        continue;
+
+                    sf::Vector2f first = sf::Vector2f((4.0f * k + col) * scale, row * scale) - size / 2.0f;
+                    sf::Vector2f second = first + sf::Vector2f(scale, scale);
+                    first = Rotate(first, direction);
+                    second = Rotate(second, direction);
+
+                    AppendRectangle(
+                        texts,
+                        position + sf::Vector2f(std::min(first.x, second.x), std::min(first.y, second.y)),
+                        position + sf::Vector2f(std::max(first.x, second.x), std::max(first.y, second.y)),
+                        color);
+                }
+            }
+        }
+    }
+
+    void DrawText(
+        std::string str,
+        unsigned int characterSize,
+        sf::Color color,
+        CellPosition cellPosition,
+        Direction direction = Direction::kTop)
+    {
+        DrawText(str, characterSize, color, GetCellCenter(cellPosition), direction);
+    }
+
+    void DrawRectangle(CellPosition cellPosition, sf::Color color)
+    {
+        sf::Vector2f topLeft = GetCellTopLeft(cellPosition);
+        AppendRectangle(
+            GetShapes(),
+            topLeft,
+            topLeft + sf::Vector2f(TGameRendererConfig::kCellSize, TGameRendererConfig::kCellSize),
+            color);
+    }
+
+    void DrawRectangle(sf::Vector2f topLeft, sf::Vector2f size, sf::Color color)
+    {
+        AppendRectangle(GetShapes(), topLeft, topLeft + size, color);
+    }
+
+    void DrawTriangle(
+        sf::Vector2f center,
+        Direction direction,
+        sf::Color color)
+    {
+        constexpr float kHalf = TGameRendererConfig::kCellSize / 2.0f;
+
+        // Same shape as Drawer's: a right triangle turned a quarter further than direction.
+        Direction turned = static_cast<Direction>((static_cast<int>(direction) + 1) % 4);
+        AppendTriangle(
+            center + Rotate({-kHalf, -kHalf}, turned),
+            center + Rotate({kHalf, -kHalf}, turned),
+            center + Rotate({kHalf, kHalf}, turned),
+            color);
+    }
+
+    void DrawTriangle(CellPosition cellPosition, Direction direction, sf::Color color)
+    {
+        DrawTriangle(GetCellCenter(cellPosition), direction, color);
+    }
+
+    void DrawCircle(sf::Vector2f center, float radius, sf::Color color)
+    {
+        AppendCircle(center, radius + 2, sf::Color(60, 60, 60));
+        AppendCircle(center, radius, color);
+    }
+
+    void DrawArrow(CellPosition cellPosition, Feis::Direction direction)
+    {
+        constexpr float kOffset = 2;
+        constexpr float kHalf = TGameRendererConfig::kCellSize / 2;
+        const sf::Vector2f points[] = {
+            {0, 0},
+            {-2 * kOffset, kOffset - kHalf},
+            {0, kOffset - kHalf},
+            {2 * kOffset, 0},
+            {0, kHalf - kOffset},
+            {-2 * kOffset, kHalf - kOffset}};
+
+        sf::Vector2f center = GetCellCenter(cellPosition);
+        Direction turned = static_cast<Direction>((static_cast<int>(direction) + 3) % 4);
+
+        // The outline is not convex; like sf::ConvexShape, fan it out from its bounding box
+        // centre, which is points[0].
+        for (std::size_t i = 1; i + 1 < 6; ++i)
+        {
+            AppendTriangle(
+                center,
+                center + Rotate(points[i], turned),
+                center + Rotate(points[i + 1], turned),
+                sf::Color(60, 60, 60));
+        }
+    }
+
+    sf::Vector2f GetCellCenter(CellPosition cellPosition)
+    {
+        return GetCellTopLeft(cellPosition) + sf::Vector2f(TGameRendererConfig::kCellSize / 2, TGameRendererConfig::kCellSize / 2);
+    }
+    sf::Vector2f GetCellTopLeft(CellPosition cellPosition)
+    {
+        return GetBorderTopLeft() +
+               sf::Vector2f(cellPosition.col, cellPosition.row) * static_cast<float>(TGameRendererConfig::kCellSize);
+    }
+    sf::Vector2f GetBorderTopLeft()
+    {
+        return sf::Vector2f(TGameRendererConfig::kBoardLeft, TGameRendererConfig::kBoardTop);
+    }
+
+    // Binary PPM (P6), written with a single call.
+    bool WritePpm(const std::string &filename) const
+    {
+        std::string header = "P6\n" + std::to_string(width_) + " " + std::to_string(height_) + "\n255\n";
+        std::vector<std::uint8_t> file(header.begin(), header.end());
+        file.insert(file.end(), pixels_.begin(), pixels_.end());
+
+        std::FILE *out = std::fopen(filename.c_str(), "wb");
+        if (out == nullptr)
+            return false;
+
+        bool written = std::fwrite(file.data(), 1, file.size(), out) == file.size();
+        return std::fclose(out) == 0 && written;
+    }
+
+private:
+    std::vector<Primitive> &GetShapes()
+    {
+        return recording_ ? recording_->shapes : batch_.shapes;
+    }
+
+    static void AppendRectangle(std::vector<Primitive> &primitives, sf::Vector2f topLeft, sf::Vector2f bottomRight, sf::Color color)
+    {
+        Primitive primitive{};
+        primitive.kind = Primitive::Kind::kRectangle;
+        primitive.points[0] = topLeft;
+        primitive.points[1] = bottomRight;
+        primitive.color = color;
+        primitives.push_back(primitive);
+    }
+
+    void AppendTriangle(sf::Vector2f a, sf::Vector2f b, sf::Vector2f c, sf::Color color)
+    {
+        Primitive primitive{};
+        primitive.kind = Primitive::Kind::kTriangle;
+        primitive.points[0] = a;
+        primitive.points[1] = b;
+        primitive.points[2] = c;
+        primitive.color = color;
+        GetShapes().push_back(primitive);
+    }
+
+    void AppendCircle(sf::Vector2f center, float radius, sf::Color color)
+    {
+        Primitive primitive{};
+        primitive.kind = Primitive::Kind::kCircle;
+        primitive.points[0] = center;
+        primitive.radius = radius;
+        primitive.color = color;
+        GetShapes().push_back(primitive);
+    }
+
+    // Quarter turns clockwise on screen, as in Drawer.
+    static sf::Vector2f Rotate(sf::Vector2f point, Direction direction)
+    {
+        switch (direction)
+        {
+        case Direction::kRight:
+            return {-point.y, point.x};
+        case Direction::kBottom:
+            return {-point.x, -point.y};
+        case Direction::kLeft:
+            return {point.y, -point.x};
+        default:
+            return point;
+        }
+    }
+
+    // Five rows of three bits, most significant bit leftmost.
+    static const std::uint8_t *GetGlyph(char c)
+    {
+        static const std::uint8_t kDigits[10][5] = {
+            {7, 5, 5, 5, 7},
+            {2, 6, 2, 2, 7},
+            {7, 1, 7, 4, 7},
+            {7, 1, 7, 1, 7},
+            {5, 5, 7, 1, 1},
+            {7, 4, 7, 1, 7},
+            {7, 4, 7, 5, 7},
+            {7, 1, 1, 1, 1},
+            {7, 5, 7, 5, 7},
+            {7, 5, 7, 1, 7}};
+        static const std::uint8_t kColon[5] = {0, 2, 0, 2, 0};
+        static const std::uint8_t kLeftParenthesis[5] = {1, 2, 2, 2, 1};
+        static const std::uint8_t kRightParenthesis[5] = {4, 2, 2, 2, 4};
+        static const std::uint8_t kMinus[5] = {0, 0, 7, 0, 0};
+
+        if (c >= '0' && c <= '9')
+            return kDigits[c - '0'];
+
+        switch (c)
+        {
+        case ':':
+            return kColon;
+        case '(':
+            return kLeftParenthesis;
+        case ')':
+            return kRightParenthesis;
+        case '-':
+            return kMinus;
+        default:
+            return nullptr;
+        }
+    }
+
+    // A pixel is covered when its centre is.
+    void Rasterize(const Primitive &primitive)
+    {
+        if (primitive.color.a == 0)
+            return;
+
+        sf::Vector2f min = primitive.points[0];
+        sf::Vector2f max = primitive.points[0];
+
+        switch (primitive.kind)
+        {
+        case Primitive::Kind::kRectangle:
+            max = primitive.points[1];
+            break;
+        case Primitive::Kind::kTriangle:
+            for (int i = 1; i < 3; ++i)
+            {
+                min = sf::Vector2f(std::min(min.x, primitive.points[i].x), std::min(min.y, primitive.points[i].y));
+                max = sf::Vector2f(std::max(max.x, primitive.points[i].x), std::max(max.y, primitive.points[i].y));
+            }
+            break;
+        case Primitive::Kind::kCircle:
+            min -= sf::Vector2f(primitive.radius, primitive.radius);
+            max += sf::Vector2f(primitive.radius, primitive.radius);
+            break;
+        }
+
+        int left = std::max(0, static_cast<int>(std::ceil(min.x - 0.5f)));
+        int top = std::max(0, static_cast<int>(std::ceil(min.y - 0.5f)));
+        int right = std::min(static_cast<int>(width_), static_cast<int>(std::ceil(max.x - 0.5f)));
+        int bottom = std::min(static_cast<int>(height_), static_cast<int>(std::ceil(max.y - 0.5f)));
+
+        const sf::Vector2f *p = primitive.points;
+        float area = (p[1].x - p[0].x) * (p[2].y - p[0].y) - (p[1].y - p[0].y) * (p[2].x - p[0].x);
+
+        for (int y = top; y < bottom; ++y)
+        {
+            std::uint8_t *pixel = &pixels_[(static_cast<std::size_t>(y) * width_ + left) * 3];
+
+            for (int x = left; x < right; ++x, pixel += 3)
+            {
+                sf::Vector2f center(x + 0.5f, y + 0.5f);
+
+                if (primitive.kind == Primitive::Kind::kTriangle)
+                {
+                    bool inside = true;
+                    for (int i = 0; i < 3 && inside; ++i)
+                    {
+                        const sf::Vector2f &a = p[i];
+                        const sf::Vector2f &b = p[(i + 1) % 3];
+                        float edge = (b.x - a.x) * (center.y - a.y) - (b.y - a.y) * (center.x - a.x);
+                        inside = area >= 0 ? edge >= 0 : edge <= 0;
+                    }
+                    if (!inside)
+                        continue;
+                }
+                else if (primitive.kind == Primitive::Kind::kCircle)
+                {
+                    sf::Vector2f offset = center - p[0];
+                    if (offset.x * offset.x + offset.y * offset.y > primitive.radius * primitive.radius)
+                        continue;
+                }
+
+                pixel[0] = primitive.color.r;
+                pixel[1] = primitive.color.g;
+                pixel[2] = primitive.color.b;
+            }
+        }
+    }
+
+    unsigned int width_;
+    unsigned int height_;
+    std::vector<std::uint8_t> pixels_;
+    Geometry batch_;
+    Geometry *recording_ = nullptr;
+};
+#endif
@@ -0,0 +1,108 @@
+#ifndef SOFTWARE_GAME_RENDERER_HPP
+#define SOFTWARE_GAME_RENDERER_HPP
+#include <vector>
+#include <cstdint>
+#include "PDOGS.cpp"
+#include "SoftwareDrawer.hpp"
+#include "LayeredCellRenderer.hpp"
+
+// GameRenderer for SoftwareDrawer: the same three passes, with pass one kept as a pixel buffer per
+// board version and passes two and three redrawn only for dirty cells.
+template <typename TGameRendererConfig>
+class SoftwareGameRenderer
+{
+public:
+    using GameManagerConfig = Feis::GameManagerConfig;
+
+    static constexpr unsigned int kWidth =
+        2 * TGameRendererConfig::kBoardLeft + GameManagerConfig::kBoardWidth * TGameRendererConfig::kCellSize;
+    static constexpr unsigned int kHeight =
+        TGameRendererConfig::kBoardTop + TGameRendererConfig::kBoardLeft + GameManagerConfig::kBoardHeight * TGameRendererConfig::kCellSize;
+
+    SoftwareGameRenderer()
+        : drawer_(kWidth, kHeight), staticLayerVersion_{}, hasStaticLayer_{false}, hasCellGeometries_{false}
+    {
+    }
+
+    void Render(const Feis::IGameInfo &gameManagerInfo)
+    {
+        if (!hasStaticLayer_ || staticLayerVersion_ != gameManagerInfo.GetBoardVersion())
+        {
+            RenderStaticLayer(gameManagerInfo);
+        }
+
+        drawer_.DrawLayer(staticLayer_);
+
+        for (int row = 0; row < GameManagerConfig::kBoardHeight; ++row)
+        {
+            for (int col = 0; col < GameManagerConfig::kBoardWidth; ++col)
+            {
+                layeredCellRenderer_.RenderCachedPassTwo(
+                    gameManagerInfo, drawer_, {row, col}, !hasCellGeometries_ || gameManagerInfo.IsCellDirty({row, col}));
+            }
+        }
+        drawer_.Flush();
+
+        for (int row = 0; row < GameManagerConfig::kBoardHeight; ++row)
+        {
+            for (int col = 0; col < GameManagerConfig::kBoardWidth; ++col)
+            {
+                layeredCellRenderer_.RenderCachedPassThree(
+                    gameManagerInfo, drawer_, {row, col}, !hasCellGeometries_ || gameManagerInfo.IsCellDirty({row, col}));
+            }
+        }
+        drawer_.Flush();
+
+        hasCellGeometries_ = true;
+
+        int timeLeft = gameManagerInfo.GetEndTime() - gameManagerInfo.GetElapsedTime();
+
+        drawer_.DrawText(
+            std::to_string(timeLeft / (TGameRendererConfig::kTicksPerSecond * 60) / 10) +
+                std::to_string(timeLeft / (TGameRendererConfig::kTicksPerSecond * 60) % 10) +
+                ":" +
+                std::to_string(timeLeft / (TGameRendererConfig::kTicksPerSecond) % 60 / 10) +
+                std::to_string(timeLeft / (TGameRendererConfig::kTicksPerSecond) % 10),
+            20,
+            sf::Color::White,
+            sf::Vector2f(50, 30));
+        drawer_.Flush();
+    }
+
+    void Invalidate()
+    {
+        hasStaticLayer_ = false;
+        hasCellGeometries_ = false;
+    }
+
+    const SoftwareDrawer<TGameRendererConfig> &GetDrawer() const { return drawer_; }
+
+    bool WritePpm(const std::string &filename) const { return drawer_.WritePpm(filename); }
+
+private:
+    void RenderStaticLayer(const Feis::IGameInfo &gameManagerInfo)
+    {
+        drawer_.Clear();
+
+        for (int row = 0; row < GameManagerConfig::kBoardHeight; ++row)
+        {
+            for (int col = 0; col < GameManagerConfig::kBoardWidth; ++col)
+            {
+                layeredCellRenderer_.RenderPassOne(gameManagerInfo, drawer_, {row, col});
+            }
+        }
+        drawer_.Flush();
+
+        staticLayer_ = drawer_.GetPixels();
+        staticLayerVersion_ = gameManagerInfo.GetBoardVersion();
+        hasStaticLayer_ = true;
+    }
+
+    SoftwareDrawer<TGameRendererConfig> drawer_;
+    LayeredCellRenderer<TGameRendererConfig, SoftwareDrawer<TGameRendererConfig>> layeredCellRenderer_;
+    std::vector<std::uint8_t> staticLayer_;
+    std::size_t staticLayerVersion_;
+    bool hasStaticLayer_;
+    bool hasCellGeometries_;
+};
+#endif
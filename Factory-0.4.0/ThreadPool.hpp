@@ -0,0 +1,190 @@
+#ifndef THREAD_POOL_HPP
+#define THREAD_POOL_HPP
+#include <thread>
+#include <mutex>
+#include <condition_variable>
+#include <deque>
+#include <vector>
+#include <memory>
+#include <functional>
+#include <atomic>
+#include <cassert>
+
+namespace Feis
+{
+    // Fixed set of workers, each owning a task deque. A worker runs its own newest task first and
+    // steals the oldest task of another worker when its deque runs dry. Wait() must not be called
+    // from inside one of the pool's own tasks.
+    class ThreadPool
+    {
+    public:
+        ThreadPool(std::size_t threadCount = std::thread::hardware_concurrency())
+        {
+            if (threadCount == 0)
+            {
+                threadCount = 1;
+            }
+
+            for (std::size_t i = 0; i < threadCount; ++i)
+            {
+                workers_.push_back(std::make_unique<Worker>());
+            }
+            for (std::size_t i = 0; i < threadCount; ++i)
+            {
+                threads_.emplace_back(&ThreadPool::Run, this, i);
+            }
+        }
+
+        ThreadPool(const ThreadPool &) = delete;
+
+        ThreadPool &operator=(const ThreadPool &) = delete;
+
+        ~ThreadPool()
+        {
+            {
+                std::lock_guard<std::mutex> lock(mutex_);
+                stopping_ = true;
+            }
+            wakeUp_.notify_all();
+
+            for (auto &thread : threads_)
+            {
+                thread.join();
+            }
+        }
+
+        std::size_t GetThreadCount() const
+        {
+            return threads_.size();
+        }
+
+        // A task submitted by one of this pool's workers goes to that worker's deque; any other
+        // thread, including a worker of another pool, spreads its tasks round robin.
+        void Submit(std::function<void()> task)
+        {
+            std::size_t index;
+            if (GetCurrentWorker().pool == this)
+            {
+                index = GetCurrentWorker().index;
+            }
+            else
+            {
+                index = nextWorker_++ % workers_.size();
+            }
+
+            {
+                std::lock_guard<std::mutex> lock(workers_[index]->mutex);
+                workers_[index]->tasks.push_back(std::move(task));
+            }
+            {
+                std::lock_guard<std::mutex> lock(mutex_);
+                ++queuedCount_;
+                ++pendingCount_;
+            }
+            wakeUp_.notify_one();
+        }
+
+        // Blocks until every task submitted to this pool has finished, whoever submitted it, so
+        // threads sharing a pool also wait for each other's tasks. Give independent batches their
+        // own pools if that matters.
+        void Wait()
+        {
+            assert(GetCurrentWorker().pool != this && "Wait() must not be called from inside a task");
+
+            std::unique_lock<std::mutex> lock(mutex_);
+            idle_.wait(lock, [this]
+                       { return pendingCount_ == 0; });
+        }
+
+    private:
+        struct Worker
+        {
+            std::mutex mutex;
+            std::deque<std::function<void()>> tasks;
+        };
+
+        // The pool and index of the worker running on this thread, if any. Keyed by pool, since a
+        // task of one pool may submit to another.
+        struct CurrentWorker
+        {
+            const ThreadPool *pool = nullptr;
+            std::size_t index = 0;
+        };
+
+        static CurrentWorker &GetCurrentWorker()
+        {
+            static thread_local CurrentWorker currentWorker;
+            return currentWorker;
+        }
+
+        bool TryTake(std::size_t index, std::function<void()> &task)
+        {
+            {
+                Worker &worker = *workers_[index];
+                std::lock_guard<std::mutex> lock(worker.mutex);
+                if (!worker.tasks.empty())
+                {
+                    task = std::move(worker.tasks.back());
+                    worker.tasks.pop_back();
+                    return true;
+                }
+            }
+
+            for (std::size_t k = 1; k < workers_.size(); ++k)
+            {
+                Worker &victim = *workers_[(index + k) % workers_.size()];
+                std::lock_guard<std::mutex> lock(victim.mutex);
+                if (!victim.tasks.empty())
+                {
+                    task = std::move(victim.tasks.front());
+                    victim.tasks.pop_front();
+                    return true;
+                }
+            }
+            return false;
+        }
+
+        void Run(std::size_t index)
+        {
+            GetCurrentWorker() = {this, index};
+
+            while (true)
+            {
+                std::function<void()> task;
+                if (TryTake(index, task))
+                {
+                    {
+                        std::lock_guard<std::mutex> lock(mutex_);
+                        --queuedCount_;
+                    }
+
+                    task();
+
+                    std::lock_guard<std::mutex> lock(mutex_);
+                    if (--pendingCount_ == 0)
+                    {
+                        idle_.notify_all();
+                    }
+                    continue;
+                }
+
+                std::unique_lock<std::mutex> lock(mutex_);
+                wakeUp_.wait(lock, [this]
+                             { return stopping_ || queuedCount_ > 0; });
+                if (stopping_ && queuedCount_ == 0)
+                    return;
+            }
+        }
+
+        std::vector<std::unique_ptr<Worker>> workers_;
+        std::vector<std::thread> threads_;
+        std::mutex mutex_;
+        std::condition_variable wakeUp_;
+        std::condition_variable idle_;
+        std::size_t queuedCount_ = 0;
+        std::size_t pendingCount_ = 0;
+        bool stopping_ = false;
+        std::atomic<std::size_t> nextWorker_{0};
+    };
+}
+#endif
@@ -0,0 +1,70 @@
+#define USE_HEADLESS
+#include <iostream>
+#include <chrono>
+#include <SFML/Graphics.hpp>
+
+#include "PDOGS.cpp"
+#include "ScriptedGamePlayer.hpp"
+#include "Replay.hpp"
+#include "SoftwareGameRenderer.hpp"
+
+using namespace Feis;
+
+struct GameRendererConfig
+{
+    static constexpr int kTicksPerSecond = 9000;
+    static constexpr int kCellSize = 20;
+    static constexpr int kBoardLeft = 20;
+    static constexpr int kBoardTop = 60;
+    static constexpr int kBorderSize = 1;
+};
+
+// Replays a saved game without a window and writes every Nth tick as a PPM frame, e.g. for
+// `ffmpeg -i frame_%05d.ppm timelapse.mp4`.
+int main(int argc, char **argv)
+{
+    if (argc < 4)
+    {
+        std::cout << "Usage: Timelapse <divisor> <seed> <replay file> [ticks per frame] [frame prefix]" << std::endl;
+        return 1;
+    }
+
+    int commonDividor = std::stoi(argv[1]);
+    unsigned int seed = static_cast<unsigned int>(std::stoul(argv[2]));
+    ScriptedGamePlayer player(LoadReplay(argv[3]));
+    int ticksPerFrame = argc > 4 ? std::stoi(argv[4]) : 30;
+    std::string prefix = argc > 5 ? argv[5] : "frame_";
+
+    GameManager gameManager(&player, commonDividor, seed);
+    gameManager.EnableDirtyTracking(true);
+
+    SoftwareGameRenderer<GameRendererConfig> renderer;
+
+    auto startTime = std::chrono::steady_clock::now();
+    int frame = 0;
+
+    while (true)
+    {
+        if (gameManager.GetElapsedTime() % ticksPerFrame == 0 || gameManager.IsGameOver())
+        {
+            renderer.Render(gameManager);
+            gameManager.ClearDirtyCells();
+
+            char number[16];
+            std::snprintf(number, sizeof(number), "%05d", frame++);
+            if (!renderer.WritePpm(prefix + number + ".ppm"))
+            {
+                std::cout << "Error writing " << prefix + number + ".ppm" << std::endl;
+                return 1;
+            }
+        }
+
+        if (gameManager.IsGameOver())
+            break;
+
+        gameManager.Update();
+    }
+
+    double seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - startTime).count();
+    std::cout << frame << " frames, score " << gameManager.GetScores() << ", " << frame / seconds << " frames/s" << std::endl;
+}